@@ -0,0 +1,198 @@
+//
+// Airtime and duty cycle consequences of transmission thresholds and batching.
+//
+// airtime_sim [-p sample period in s] [-x series repeats] [-r data rate] [-a] [-s snr] [-n snr sigma]
+//             [-t thresholds] [-l batch latencies]
+//
+// Replays sample_tick(), send_message() and the TX_DONE handler of ../MBED/main.cpp over
+// conso_data, read cyclically like read_meter(), against the radio model of lora_sim.h.
+// -a turns ADR on, the link then moves the data rate. Lists are comma separated, a batch
+// latency of 0 sends every correction in its own frame.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "conso_data.h"
+#include "lora_sim.h"
+#include "node_config.h"
+#include "node_sample.h"
+#include "options.h"
+#include "uplink_batch.h"
+
+struct node_sim_t {
+    dual_prediction_t prediction;
+    uplink_batch_t batch;
+    std::vector<double> batch_times;    // sampling time of every record in the batch
+    lora_radio_t radio;
+    int max_payload;
+    uint32_t max_latency;
+    uint32_t sequence;
+    uint32_t skipped;
+    bool model_version_sent;
+    bool tx_in_flight;
+    double tx_done_at;
+    double retry_at;                    // < 0 when no retry is pending
+
+    long corrections;
+    long dropped;
+    double delay_total;
+    double delay_max;
+};
+
+static void send_message(node_sim_t * node, double now) {
+    if (node->batch.count == 0 || node->tx_in_flight || node->retry_at >= 0) {
+        return;
+    }
+
+    double done;
+    if (lora_send(&node->radio, now, node->batch.length, &done) < 0) {
+        node->retry_at = now + (done > 0 ? done : TX_RETRY_DELAY / 1000.0);
+        return;
+    }
+
+    for (double sampled : node->batch_times) {
+        node->delay_total += now - sampled;
+        node->delay_max = fmax(node->delay_max, now - sampled);
+    }
+    node->batch_times.clear();
+    batch_reset(&node->batch);
+    node->model_version_sent = true;
+    node->tx_in_flight = true;
+    node->tx_done_at = done;
+}
+
+static void tx_done(node_sim_t * node, double now) {
+    node->tx_in_flight = false;
+    node->max_payload = eu868_max_payload(node->radio.data_rate);
+    if (batch_due(&node->batch, node->sequence, node->max_latency, node->max_payload)) {
+        send_message(node, now);
+    }
+}
+
+/**
+ * Where a full batch is sent from
+ */
+struct flush_t {
+    node_sim_t * node;
+    double now;
+};
+
+static void flush_batch(void * context) {
+    flush_t * flush = (flush_t *) context;
+    send_message(flush->node, flush->now);
+}
+
+static void sample_tick(node_sim_t * node, double now, float threshold) {
+    const int length = sizeof(conso_data) / sizeof(conso_data[0]);
+    flush_t flush = {node, now};
+    node_uplink_t uplink = {&node->batch, node->max_payload, !node->model_version_sent, &node->skipped,
+                            flush_batch, &flush};
+    node_sample_t sample;
+    int status = node_sample_step(&node->prediction, node->sequence, conso_data[node->sequence % length], threshold,
+                                  &uplink, &sample);
+    if (status < 0) {
+        node->dropped++;
+    } else if (status > 0) {
+        node->batch_times.push_back(now);
+        node->corrections++;
+    }
+    node->sequence++;
+
+    if (batch_due(&node->batch, node->sequence, node->max_latency, node->max_payload)) {
+        send_message(node, now);
+    }
+}
+
+int main(int argc, char ** argv) {
+    double period = SAMPLE_PERIOD / 1000.0;
+    int repeats = 10;
+    int data_rate = 5;
+    bool adr = false;
+    float snr = 0.0f;
+    float sigma = 3.0f;
+    std::vector<float> thresholds, latencies;
+    options_parse_list("0.05,0.1,0.3,0.5", &thresholds);
+    options_parse_list("0,8", &latencies);
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-a")) {
+            adr = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "-p")) {
+            period = atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-x")) {
+            repeats = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-r")) {
+            data_rate = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            snr = (float) atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-n")) {
+            sigma = (float) atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+            options_parse_list(argv[++i], &thresholds);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-l")) {
+            options_parse_list(argv[++i], &latencies);
+        } else {
+            fprintf(stderr, "usage: airtime_sim [-p sample period in s] [-x series repeats] [-r data rate] [-a] "
+                            "[-s snr] [-n snr sigma] [-t thresholds] [-l batch latencies]\n");
+            return 1;
+        }
+    }
+    if (data_rate < 0 || data_rate > EU868_MAX_ADR_DR || period <= 0 || repeats < 1) {
+        fprintf(stderr, "Data rate must be 0 to %d, period and repeats positive\n", EU868_MAX_ADR_DR);
+        return 1;
+    }
+
+    const long samples = (long) repeats * (long) (sizeof(conso_data) / sizeof(conso_data[0]));
+    const double duration = samples * period;
+
+    printf("Threshold; Latency; Samples; Corrections; Dropped; Frames; Blocked; Lost; Mean delay s; "
+           "Max delay s; Airtime s; Duty cycle %%; Radio mJ/day; Final DR\n");
+    for (float threshold : thresholds) {
+        for (float latency : latencies) {
+            static node_sim_t node;
+            batch_reset(&node.batch);
+            node.batch_times.clear();
+            lora_init(&node.radio, data_rate, adr, snr, sigma, 1);
+            node.max_payload = eu868_max_payload(data_rate);
+            node.max_latency = (uint32_t) latency;
+            node.sequence = 0;
+            node.skipped = 0;
+            node.model_version_sent = false;
+            node.tx_in_flight = false;
+            node.tx_done_at = 0;
+            node.retry_at = -1;
+            node.corrections = 0;
+            node.dropped = 0;
+            node.delay_total = 0;
+            node.delay_max = 0;
+
+            // Discrete events: sample ticks, TX_DONE and duty cycle retries, earliest first
+            for (long tick = 0; tick < samples;) {
+                double now = tick * period;
+                if (node.tx_in_flight && node.tx_done_at <= now
+                    && (node.retry_at < 0 || node.tx_done_at <= node.retry_at)) {
+                    tx_done(&node, node.tx_done_at);
+                } else if (node.retry_at >= 0 && node.retry_at <= now) {
+                    double retry = node.retry_at;
+                    node.retry_at = -1;
+                    send_message(&node, retry);
+                } else {
+                    sample_tick(&node, now, threshold);
+                    tick++;
+                }
+            }
+
+            const lora_radio_t & radio = node.radio;
+            long sent = node.corrections - (long) node.batch_times.size();
+            printf("%.3f; %d; %ld; %ld; %ld; %ld; %ld; %ld; %.1f; %.1f; %.1f; %.3f; %.1f; %d\n", threshold,
+                   (int) latency, samples, node.corrections, node.dropped, radio.frames, radio.blocked, radio.lost,
+                   sent ? node.delay_total / sent : 0.0, node.delay_max, radio.airtime,
+                   100.0 * radio.airtime / duration, radio.energy_mj * 86400.0 / duration, radio.data_rate);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+//
+// Benchmark of the arena runtime on a fleet replay.
+//
+// bench [-d dataset.csv] [-m model.h] [-t threshold] [-f horizon]
+//
+// Every meter of the export is one lane of a single runtime, the running lanes are stepped
+// together through the dual prediction replay and each transmitted sample forks a forecast
+// of the next horizon samples. Heap allocations are counted over the step loop: the run
+// fails if there is any, or if a lane transmits differently from model_replay.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "node_sample.h"
+#include "runtime.h"
+
+static long allocations = 0;
+
+void * operator new(size_t size) {
+    allocations++;
+    void * pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void * operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void * pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void * pointer) noexcept {
+    free(pointer);
+}
+
+int main(int argc, char ** argv) {
+    const char * path = "../Python/dataset.csv";
+    const char * model_path = NULL;
+    float threshold = 0.3f;
+    int horizon = 6;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-d")) {
+            path = argv[i + 1];
+        } else if (!strcmp(argv[i], "-m")) {
+            model_path = argv[i + 1];
+        } else if (!strcmp(argv[i], "-t")) {
+            threshold = (float) atof(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-f")) {
+            horizon = atoi(argv[i + 1]);
+        } else {
+            fprintf(stderr, "usage: bench [-d dataset.csv] [-m model.h] [-t threshold] [-f horizon]\n");
+            return 1;
+        }
+    }
+
+    lstm_model_t model;
+    if (model_path) {
+        if (model_load(&model, model_path) < 0) {
+            return 1;
+        }
+    } else {
+        model_from_parameters(&model);
+    }
+    std::vector<meter_series_t> meters;
+    if (dataset_load(path, DATASET_VALUE_COLUMN, &meters) < 0 || meters.empty()) {
+        return 1;
+    }
+    const int lanes = (int) meters.size();
+    std::vector<int> order;
+    dataset_lane_order(meters, &order);
+
+    runtime_t runtime;
+    if (runtime_create(&runtime, &model, lanes, horizon > 0 ? 1 : 0) < 0) {
+        fprintf(stderr, "Cannot create the runtime\n");
+        return 1;
+    }
+
+    // Everything the loop touches is sized here
+    std::vector<float> inputs(lanes, 0.0f);
+    std::vector<float> outputs(lanes, 0.0f);
+    std::vector<float> previous(lanes, 0.0f);
+    std::vector<float> previous_diff(lanes, 0.0f);
+    std::vector<int> transmitted(lanes, 0);
+    std::vector<float> deltas(horizon > 0 ? horizon : 1);
+    const size_t steps = meters[order[0]].values.size();
+    int active = lanes;
+
+    long allocations_before = allocations;
+    long forecasts = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < steps; ++i) {
+        active = dataset_active_lanes(meters, order, i, active);
+        if (i > 0) {
+            for (int lane = 0; lane < active; ++lane) {
+                inputs[lane] = model.scaler_folded ? previous_diff[lane] : scale_value(&model.scaler, previous_diff[lane]);
+            }
+            runtime_step(&runtime, 0, active, inputs.data(), outputs.data());
+        }
+
+        for (int lane = 0; lane < active; ++lane) {
+            float forecast = 0;
+            if (i > 0) {
+                float y_diff = model.scaler_folded ? outputs[lane] : invert_scale_value(&model.scaler, outputs[lane]);
+                forecast = previous[lane] + y_diff;
+            }
+            node_sample_t sample;
+            node_sample_decide(&sample, i == 0, meters[order[lane]].values[i], forecast, threshold);
+            transmitted[lane] += sample.transmitted;
+            previous_diff[lane] = i > 0 ? sample.value - previous[lane] : 0;
+            previous[lane] = sample.value;
+
+            // What the server reconstructs if the next samples are all skipped
+            if (sample.transmitted && horizon > 0) {
+                runtime_forecast(&runtime, lane, lanes, previous_diff[lane], horizon, deltas.data());
+                forecasts++;
+            }
+        }
+    }
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    long step_allocations = allocations - allocations_before;
+
+    int mismatches = 0;
+    long samples = 0;
+    long total = 0;
+    for (int lane = 0; lane < lanes; ++lane) {
+        const meter_series_t & meter = meters[order[lane]];
+        int length = (int) meter.values.size();
+        if (model_replay(&model, meter.values.data(), length, 0, threshold, NULL, NULL) != transmitted[lane]) {
+            fprintf(stderr, "Square %lld country %d: runtime differs from model_replay\n", meter.square, meter.country);
+            mismatches++;
+        }
+        samples += length;
+        total += transmitted[lane];
+    }
+
+    printf("%d lanes, hunit %d, arena %zu bytes, %ld samples, %ld transmitted, %ld forecasts of %d\n",
+           lanes, model.hunit, runtime.size, samples, total, forecasts, horizon);
+    printf("%.2f ns/sample, %ld allocations in the step loop, %d mismatches\n",
+           samples ? elapsed_ns / samples : 0.0, step_allocations, mismatches);
+    runtime_destroy(&runtime);
+
+    if (step_allocations) {
+        fprintf(stderr, "The step loop allocates\n");
+        return 2;
+    }
+    return mismatches ? 2 : 0;
+}
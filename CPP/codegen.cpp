@@ -0,0 +1,155 @@
+//
+// Generates the model specific kernel of ../MBED/kernel.h from a model file.
+//
+// codegen model.h kernel_generated.cpp
+//
+// Every multiply-add of lstmCellSimple/dense_nn is written out with its weight as a literal,
+// in the same order, so the generated kernel gives the same bits. Terms with a zero weight
+// are left out and unit weights folded, which only changes the sign of exact zeros and
+// sigmoid, tanh and the final bias addition absorb those.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "model.h"
+
+// Above this the unrolled code grows quadratically for little gain over the loops
+#define CODEGEN_MAX_HUNIT 16
+
+/**
+ * Float literal that converts back to exactly value
+ */
+static std::string literal(float value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);
+    std::string result = text;
+    if (result.find_first_of(".e") == std::string::npos) {
+        result += ".0";
+    }
+    return result + "f";
+}
+
+/**
+ * Appends weight * operand to a left to right sum, expression empty for the first term
+ */
+static void add_term(std::string * expression, float weight, const std::string & operand) {
+    if (weight == 0) {
+        return;
+    }
+    bool negative = weight < 0;
+    float magnitude = negative ? -weight : weight;
+    std::string product = magnitude == 1 ? operand : literal(magnitude) + " * " + operand;
+
+    if (expression->empty()) {
+        *expression = negative ? "-" + product : product;
+    } else {
+        *expression += negative ? " - " + product : " + " + product;
+    }
+}
+
+static const char * gate_names[4] = {"input_gate", "forget_gate", "cell_candidate", "output_gate"};
+
+static void write_kernel(FILE * file, const lstm_model_t * model, const char * source) {
+    const int hunit = model->hunit;
+
+    fprintf(file, "//\n// Generated by the CPP codegen tool from %s, do not edit.\n//\n", source);
+    fprintf(file, "// Kernel of model version %d, HUNIT %d, see kernel.h.\n//\n\n", model->version, hunit);
+    fprintf(file, "#ifdef GENERATED_KERNEL\n\n");
+    fprintf(file, "#include \"activation.h\"\n#include \"kernel.h\"\n#include \"parameters.h\"\n\n");
+    fprintf(file, "#if HUNIT != %d || MODEL_VERSION != %d\n", hunit, model->version);
+    fprintf(file, "#error \"kernel_generated.cpp was generated for another parameters.h, run codegen again\"\n");
+    fprintf(file, "#endif\n\n");
+    fprintf(file, model->scaler_folded ? "#ifndef MODEL_SCALER_FOLDED\n" : "#ifdef MODEL_SCALER_FOLDED\n");
+    fprintf(file, "#error \"kernel_generated.cpp was generated for another parameters.h, run codegen again\"\n");
+    fprintf(file, "#endif\n\n");
+
+    fprintf(file, "void kernel_step(float input, float * hidden_layer, float * cell_states) {\n");
+    for (int j = 0; j < hunit; ++j) {
+        fprintf(file, "    const float h%d = hidden_layer[%d];\n", j, j);
+    }
+    for (int i = 0; i < hunit; ++i) {
+        fprintf(file, "\n    // Unit %d\n", i);
+        for (int k = 0; k < 4; ++k) {
+            std::string expression;
+            add_term(&expression, model->input_weights[k * hunit + i], "input");
+            for (int j = 0; j < hunit; ++j) {
+                add_term(&expression, model->hidden_weights[(k * hunit + i) * hunit + j], "h" + std::to_string(j));
+            }
+            float bias = model->bias[k * hunit + i];
+            if (expression.empty()) {
+                expression = literal(bias);
+            } else if (bias != 0) {
+                expression += (bias < 0 ? " - " : " + ") + literal(bias < 0 ? -bias : bias);
+            }
+            fprintf(file, "    const float %s%d = activation_sigmoid(%s);\n", gate_names[k], i, expression.c_str());
+        }
+        fprintf(file, "    cell_states[%d] = forget_gate%d * cell_states[%d] + input_gate%d * cell_candidate%d;\n",
+                i, i, i, i, i);
+        fprintf(file, "    const float new_hidden%d = output_gate%d * activation_tanh(cell_states[%d]);\n", i, i, i);
+    }
+    fprintf(file, "\n");
+    for (int i = 0; i < hunit; ++i) {
+        fprintf(file, "    hidden_layer[%d] = new_hidden%d;\n", i, i);
+    }
+    fprintf(file, "}\n\n");
+
+    std::string expression;
+    for (int i = 0; i < hunit; ++i) {
+        add_term(&expression, model->dense_weights[i], "hidden_layer[" + std::to_string(i) + "]");
+    }
+    if (expression.empty()) {
+        expression = literal(model->dense_bias);
+    } else if (model->dense_bias != 0) {
+        float bias = model->dense_bias;
+        expression += (bias < 0 ? " - " : " + ") + literal(bias < 0 ? -bias : bias);
+    }
+    fprintf(file, "float kernel_dense(const float * hidden_layer) {\n");
+    fprintf(file, "    return %s;\n}\n\n", expression.c_str());
+    fprintf(file, "#endif //GENERATED_KERNEL\n");
+}
+
+static bool finite_model(const lstm_model_t * model) {
+    for (const std::vector<float> * weights : {&model->input_weights, &model->hidden_weights, &model->bias,
+                                               &model->dense_weights}) {
+        for (float weight : *weights) {
+            if (!std::isfinite(weight)) {
+                return false;
+            }
+        }
+    }
+    return std::isfinite(model->dense_bias);
+}
+
+int main(int argc, char ** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: codegen model.h kernel_generated.cpp\n");
+        return 1;
+    }
+
+    lstm_model_t model;
+    if (model_load(&model, argv[1]) < 0) {
+        return 1;
+    }
+    if (model.hunit > CODEGEN_MAX_HUNIT) {
+        fprintf(stderr, "HUNIT %d is above %d, keep the generic kernel\n", model.hunit, CODEGEN_MAX_HUNIT);
+        return 1;
+    }
+    if (!finite_model(&model)) {
+        fprintf(stderr, "%s has non finite weights\n", argv[1]);
+        return 1;
+    }
+
+    FILE * file = fopen(argv[2], "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    const char * source = strrchr(argv[1], '/');
+    write_kernel(file, &model, source ? source + 1 : argv[1]);
+    int status = ferror(file) ? 1 : 0;
+    fclose(file);
+    return status;
+}
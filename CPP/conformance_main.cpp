@@ -0,0 +1,30 @@
+//
+// Host side of the conformance check: replays conso_data through the node's dual prediction
+// and prints the hash the firmware prints at boot when built with CONFORMANCE_CHECK.
+//
+// conformance [threshold] [expected hash]
+//
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "conformance.h"
+#include "conso_data.h"
+
+int main(int argc, char ** argv) {
+    float threshold = argc > 1 ? (float) atof(argv[1]) : 0.3f;
+
+    int transmitted;
+    uint32_t hash = conformance_replay(conso_data, sizeof(conso_data) / sizeof(conso_data[0]),
+                                       threshold, &transmitted);
+    printf("Conformance hash %08lx, %d transmitted\n", (unsigned long) hash, transmitted);
+
+    if (argc > 2) {
+        uint32_t expected = (uint32_t) strtoul(argv[2], NULL, 16);
+        if (expected != hash) {
+            printf("Mismatch, expected %08lx\n", (unsigned long) expected);
+            return 1;
+        }
+    }
+    return 0;
+}
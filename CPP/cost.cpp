@@ -0,0 +1,137 @@
+//
+// Cost report of model configurations, down to the energy a node spends per day.
+//
+// cost [-p sample period in s] [-t threshold] [-r data rate] [model.h ...]
+//
+// Without model files the compiled in parameters.h is reported. Uplink and frame rates come
+// from a replay of conso_data through the node's transmission and batching logic.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "conso_data.h"
+#include "cost_model.h"
+#include "node_config.h"
+#include "node_sample.h"
+
+struct traffic_t {
+    int samples;
+    int uplinks;
+    int frames;
+    long bytes;
+};
+
+/**
+ * The radio is always free: a flushed batch is a frame sent
+ */
+struct radio_t {
+    uplink_batch_t batch;
+    node_uplink_t uplink;
+    traffic_t * traffic;
+};
+
+/**
+ * send_message(): the model version is announced by the first frame only
+ */
+static void send_batch(void * context) {
+    radio_t * radio = (radio_t *) context;
+    if (radio->batch.count == 0) {
+        return;
+    }
+    radio->traffic->frames++;
+    radio->traffic->bytes += radio->batch.length;
+    radio->uplink.announce_model = false;
+    batch_reset(&radio->batch);
+}
+
+/**
+ * Replays conso_data through the node's transmission and batching logic, node_sample_send
+ * queuing the corrections as sample_tick does
+ */
+static void replay_traffic(const lstm_model_t * model, float threshold, int max_payload, traffic_t * traffic) {
+    int length = sizeof(conso_data) / sizeof(conso_data[0]);
+    traffic->samples = length;
+    traffic->frames = 0;
+    traffic->bytes = 0;
+
+    radio_t radio;
+    uint32_t skipped = 0;
+    batch_reset(&radio.batch);
+    radio.uplink = {&radio.batch, max_payload, true, &skipped, send_batch, &radio};
+    radio.traffic = traffic;
+    traffic->uplinks = model_replay(model, conso_data, length, 0, threshold, NULL, &radio.uplink);
+    send_batch(&radio);
+}
+
+static void report(const char * name, const lstm_model_t * model, double period, float threshold, int max_payload) {
+    model_cost_t cost;
+    cost_analyse(model, &cost);
+    cost.host_ns = cost_measure_ns(model, 2000000 / (model->hunit * model->hunit + 4));
+
+    traffic_t traffic;
+    replay_traffic(model, threshold, max_payload, &traffic);
+
+    for (int m = 0; m < mcu_profile_count; ++m) {
+        for (int r = 0; r < radio_profile_count; ++r) {
+            day_energy_t energy;
+            cost_day_energy(&cost, &mcu_profiles[m], &radio_profiles[r], period,
+                            (double) traffic.uplinks / traffic.samples, (double) traffic.frames / traffic.samples,
+                            (double) traffic.bytes / traffic.samples, &energy);
+            printf("%s; %d; %ld; %ld; %ld; %ld; %ld; %.1f; %s; %.0f; %.2f; %s; %.0f; %.0f; %.1f; %.1f; %.1f; %.1f\n",
+                   name, cost.hunit, cost.parameter_bytes, cost.state_bytes + cost.stack_bytes, cost.macs,
+                   cost.activations, cost.adaptation_macs, cost.host_ns, mcu_profiles[m].name,
+                   cost_cycles(&cost, &mcu_profiles[m]),
+                   1000.0 * cost_cycles(&cost, &mcu_profiles[m]) / (mcu_profiles[m].clock_mhz * 1e6)
+                       * mcu_profiles[m].run_mw,
+                   radio_profiles[r].name, energy.uplinks, energy.frames, energy.compute_mj, energy.radio_mj,
+                   energy.sleep_mj, energy.total_mj);
+        }
+    }
+}
+
+int main(int argc, char ** argv) {
+    double period = SAMPLE_PERIOD / 1000.0;
+    float threshold = 0.3f;
+    int data_rate = 5;
+    std::vector<const char *> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            period = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            threshold = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            data_rate = atoi(argv[++i]);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (period <= 0) {
+        fprintf(stderr, "usage: cost [-p sample period in s] [-t threshold] [-r data rate] [model.h ...]\n");
+        return 1;
+    }
+    int max_payload = eu868_max_payload(data_rate);
+
+    printf("Model; HUNIT; Flash bytes; RAM bytes; MACs; Activations; Adaptation MACs; Host ns; MCU; Cycles; "
+           "uJ/inference; Radio; Uplinks/day; Frames/day; Compute mJ/day; Radio mJ/day; Sleep mJ/day; "
+           "Total mJ/day\n");
+
+    if (paths.empty()) {
+        lstm_model_t model;
+        model_from_parameters(&model);
+        report("parameters.h", &model, period, threshold, max_payload);
+    }
+    int status = 0;
+    for (const char * path : paths) {
+        lstm_model_t model;
+        if (model_load(&model, path) < 0) {
+            status = 1;
+            continue;
+        }
+        report(path, &model, period, threshold, max_payload);
+    }
+    return status;
+}
@@ -0,0 +1,99 @@
+//
+// Cost of a model configuration on the node: memory, arithmetic, time and energy.
+//
+
+#include <chrono>
+#include <cstring>
+
+#include "cost_model.h"
+#include "memory_plan.h"
+
+// Activation cost depends on the kernel variant built: the DETERMINISTIC_MATH exp is a
+// short polynomial, libm expf a generic implementation
+#ifdef DETERMINISTIC_MATH
+#define ACTIVATION_CYCLES(deterministic, libm) (deterministic)
+#else
+#define ACTIVATION_CYCLES(deterministic, libm) (libm)
+#endif
+
+const mcu_profile_t mcu_profiles[] = {
+    // DISCO_L475VG_IOT01A, single precision FPU
+    {"STM32L475 (M4F)", 80.0f, 29.0f, 3.6f, 4.0f, ACTIVATION_CYCLES(50.0f, 170.0f)},
+    // DISCO_L072CZ_LRWAN1 / MTB_MURATA_ABZ, software floating point
+    {"STM32L072 (M0+)", 32.0f, 10.5f, 4.3f, 100.0f, ACTIVATION_CYCLES(1100.0f, 2500.0f)},
+};
+const int mcu_profile_count = sizeof(mcu_profiles) / sizeof(mcu_profiles[0]);
+
+const radio_profile_t radio_profiles[] = {
+    // 14 dBm, 125 kHz, coding rate 4/5
+    {"SX1276 SF7", 6.0f, 0.21f},
+    {"SX1276 SF12", 160.0f, 4.75f},
+};
+const int radio_profile_count = sizeof(radio_profiles) / sizeof(radio_profiles[0]);
+
+void cost_analyse(const lstm_model_t * model, model_cost_t * cost) {
+    const long hunit = model->hunit;
+
+    cost->hunit = model->hunit;
+    long weights = 4 * hunit + 4 * hunit * hunit + 4 * hunit + hunit + 1;
+    cost->parameter_bytes = weights * (long) sizeof(float) + (model->scaler_folded ? 0 : 4 * (long) sizeof(float));
+    cost->state_bytes = 2 * hunit * (long) sizeof(float);
+    cost->stack_bytes = (long) memory_plan_cell_stack_bytes(hunit);
+
+    // Gates: input weight, recurrent weights, bias. Then cell and hidden state, dense head.
+    cost->macs = 4 * hunit + 4 * hunit * hunit + 4 * hunit + 3 * hunit + hunit + 1;
+    // Scaling, unscaling, differencing and its inverse, folded models skip the first two
+    cost->macs += model->scaler_folded ? 2 : 6;
+    cost->activations = 5 * hunit;
+
+#ifdef ONLINE_DENSE
+    cost->adaptation_macs = 2 * hunit + 2 + (model->scaler_folded ? 1 : 3);
+#else
+    cost->adaptation_macs = 0;
+#endif
+    cost->host_ns = 0;
+}
+
+double cost_measure_ns(const lstm_model_t * model, int steps) {
+    float hidden_layer[MODEL_MAX_HUNIT];
+    float cell_states[MODEL_MAX_HUNIT];
+    memcpy(hidden_layer, model->hidden_layer.data(), model->hunit * sizeof(float));
+    memcpy(cell_states, model->cell_states.data(), model->hunit * sizeof(float));
+
+    volatile float sink = 0;
+    float input = 0.1f;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; ++i) {
+        model_step(model, input, hidden_layer, cell_states);
+        float output = model_dense(model, hidden_layer);
+        // Keeps the input moving like a real series would
+        input = 0.5f * output + 0.05f * (float) (i & 7);
+        sink = output;
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    (void) sink;
+    return steps > 0 ? elapsed / steps : 0;
+}
+
+double cost_cycles(const model_cost_t * cost, const mcu_profile_t * mcu) {
+    return cost->macs * (double) mcu->cycles_per_mac + cost->activations * (double) mcu->cycles_per_activation;
+}
+
+void cost_day_energy(const model_cost_t * cost, const mcu_profile_t * mcu, const radio_profile_t * radio,
+                     double sample_period, double uplink_ratio, double frame_ratio, double bytes_ratio,
+                     day_energy_t * energy) {
+    const double day = 86400.0;
+
+    energy->samples = day / sample_period;
+    energy->uplinks = energy->samples * uplink_ratio;
+    energy->frames = energy->samples * frame_ratio;
+    energy->payload_bytes = energy->samples * bytes_ratio;
+
+    // cycles / Hz * mW = mJ
+    double inference_mj = cost_cycles(cost, mcu) / (mcu->clock_mhz * 1e6) * mcu->run_mw;
+    double adaptation_mj = cost->adaptation_macs * (double) mcu->cycles_per_mac / (mcu->clock_mhz * 1e6) * mcu->run_mw;
+    energy->compute_mj = energy->samples * inference_mj + energy->uplinks * adaptation_mj;
+    energy->radio_mj = energy->frames * radio->frame_mj + energy->payload_bytes * radio->byte_mj;
+    energy->sleep_mj = mcu->sleep_uw * day / 1000.0;
+    energy->total_mj = energy->compute_mj + energy->radio_mj + energy->sleep_mj;
+}
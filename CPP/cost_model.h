@@ -0,0 +1,81 @@
+//
+// Cost of a model configuration on the node: memory, arithmetic, time and energy.
+//
+// Analytical counts come from the lstmCellSimple/dense_nn loop structure, MCU figures from
+// per target profiles (cycles per operation and power draw, datasheet orders of magnitude,
+// not measurements), host time is measured with model_step.
+//
+
+#ifndef CPP_COST_MODEL_H
+#define CPP_COST_MODEL_H
+
+#include "model.h"
+
+struct mcu_profile_t {
+    const char * name;
+    float clock_mhz;
+    float run_mw;                   // core running from flash at clock_mhz
+    float sleep_uw;                 // stop mode with RTC, between samples
+    float cycles_per_mac;           // multiply + add with both operand loads
+    float cycles_per_activation;    // sigmoid or tanh of the kernel variant built
+};
+
+struct radio_profile_t {
+    const char * name;
+    float frame_mj;                 // preamble, LoRaWAN header and MIC, both receive windows
+    float byte_mj;                  // each application payload byte
+};
+
+struct model_cost_t {
+    int hunit;
+    long parameter_bytes;           // const weights, in flash
+    long state_bytes;               // h and c, in RAM
+    long stack_bytes;               // lstmCellSimple locals
+    long macs;                      // multiply-adds per sample, preprocessing included
+    long activations;               // sigmoid and tanh calls per sample
+    long adaptation_macs;           // per correction, ONLINE_DENSE builds only
+    double host_ns;                 // measured per sample on this machine
+};
+
+struct day_energy_t {
+    double samples;                 // per day
+    double uplinks;                 // corrections per day
+    double frames;                  // LoRa frames per day
+    double payload_bytes;           // per day
+    double compute_mj;
+    double radio_mj;
+    double sleep_mj;
+    double total_mj;
+};
+
+extern const mcu_profile_t mcu_profiles[];
+extern const int mcu_profile_count;
+extern const radio_profile_t radio_profiles[];
+extern const int radio_profile_count;
+
+/**
+ * Static counts of one inference with model
+ */
+void cost_analyse(const lstm_model_t * model, model_cost_t * cost);
+
+/**
+ * Mean host time of model_step + model_dense over steps samples, in ns
+ */
+double cost_measure_ns(const lstm_model_t * model, int steps);
+
+/**
+ * Estimated cycles of one inference on mcu
+ */
+double cost_cycles(const model_cost_t * cost, const mcu_profile_t * mcu);
+
+/**
+ * cost - static counts of the model
+ * mcu, radio - target profiles
+ * sample_period - seconds between samples
+ * uplink_ratio - corrections per sample, frame_ratio - frames per sample, bytes_ratio - payload bytes per sample
+ */
+void cost_day_energy(const model_cost_t * cost, const mcu_profile_t * mcu, const radio_profile_t * radio,
+                     double sample_period, double uplink_ratio, double frame_ratio, double bytes_ratio,
+                     day_energy_t * energy);
+
+#endif //CPP_COST_MODEL_H
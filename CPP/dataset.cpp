@@ -0,0 +1,115 @@
+//
+// Loader for the Telecom Italia activity export in Python/dataset.csv.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+#include "dataset.h"
+#include "dataset_cache.h"
+
+/**
+ * Copies the cached columns out, -1 if the cache cannot be used for this column
+ */
+static int load_cached(const char * path, int column, std::vector<meter_series_t> * meters) {
+    if (column < DATASET_FIRST_VALUE_COLUMN || column >= DATASET_FIRST_VALUE_COLUMN + DATASET_CACHE_COLUMNS) {
+        return -1;
+    }
+    dataset_cache_t cache;
+    if (dataset_cache_open(&cache, path) < 0) {
+        return -1;
+    }
+
+    meters->clear();
+    meters->resize(cache.header->meters);
+    for (unsigned int m = 0; m < cache.header->meters; ++m) {
+        meter_series_t & meter = (*meters)[m];
+        int rows = cache.meters[m].rows;
+        const long long * timestamps = dataset_cache_timestamps(&cache, m);
+        const float * values = dataset_cache_values(&cache, m, column);
+        meter.square = cache.meters[m].square;
+        meter.country = cache.meters[m].country;
+        meter.timestamps.assign(timestamps, timestamps + rows);
+        meter.values.assign(values, values + rows);
+    }
+    int rows = (int) cache.header->rows;
+    dataset_cache_close(&cache);
+    return rows;
+}
+
+static int load_text(const char * path, int column, std::vector<meter_series_t> * meters) {
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open dataset %s\n", path);
+        return -1;
+    }
+
+    std::map<std::pair<long long, int>, size_t> index;
+    char line[512];
+    int rows = 0;
+
+    meters->clear();
+    while (fgets(line, sizeof(line), file)) {
+        // Split in place, empty fields are missing values
+        const char * fields[16];
+        int count = 0;
+        fields[count++] = line;
+        for (char * cursor = line; *cursor && count < 16; ++cursor) {
+            if (*cursor == ',') {
+                *cursor = 0;
+                fields[count++] = cursor + 1;
+            }
+        }
+        if (count <= column || count < 3) {
+            continue;
+        }
+
+        long long square = atoll(fields[0]);
+        long long timestamp = (long long) atof(fields[1]);
+        int country = atoi(fields[2]);
+        float value = (float) atof(fields[column]);
+
+        std::pair<long long, int> key(square, country);
+        auto found = index.find(key);
+        if (found == index.end()) {
+            found = index.emplace(key, meters->size()).first;
+            meter_series_t meter;
+            meter.square = square;
+            meter.country = country;
+            meters->push_back(meter);
+        }
+        meter_series_t & meter = (*meters)[found->second];
+        meter.timestamps.push_back(timestamp);
+        meter.values.push_back(value);
+        rows++;
+    }
+
+    fclose(file);
+    return rows;
+}
+
+int dataset_load(const char * path, int column, std::vector<meter_series_t> * meters) {
+    int rows = load_cached(path, column, meters);
+    return rows >= 0 ? rows : load_text(path, column, meters);
+}
+
+void dataset_lane_order(const std::vector<meter_series_t> & meters, std::vector<int> * order) {
+    order->resize(meters.size());
+    for (size_t lane = 0; lane < meters.size(); ++lane) {
+        (*order)[lane] = (int) lane;
+    }
+    std::stable_sort(order->begin(), order->end(), [&meters](int a, int b) {
+        return meters[a].values.size() > meters[b].values.size();
+    });
+}
+
+int dataset_active_lanes(const std::vector<meter_series_t> & meters, const std::vector<int> & order, size_t step,
+                         int active) {
+    while (active > 0 && meters[order[active - 1]].values.size() <= step) {
+        active--;
+    }
+    return active;
+}
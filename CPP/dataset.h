@@ -0,0 +1,46 @@
+//
+// Loader for the Telecom Italia activity export in Python/dataset.csv.
+//
+// Columns: square id, timestamp (ms), country code, sms in, sms out, call in, call out, internet.
+// Each (square, country code) pair is handled as one meter, sampled every 10 minutes.
+//
+
+#ifndef CPP_DATASET_H
+#define CPP_DATASET_H
+
+#include <vector>
+
+// Column used as meter reading by the notebooks (internet activity)
+#define DATASET_VALUE_COLUMN 7
+
+struct meter_series_t {
+    long long square;
+    int country;
+    std::vector<long long> timestamps;  // ms since epoch
+    std::vector<float> values;          // missing readings are 0, as in the notebooks
+};
+
+/**
+ * Reads the columnar cache of dataset_cache.h, built on first use, and falls back to parsing
+ * the text when the cache cannot be written or column is not cached.
+ * path - csv export
+ * column - column read as meter value
+ * meters - one series per (square, country), in order of first appearance
+ * Returns the number of rows read, -1 if the file cannot be opened
+ */
+int dataset_load(const char * path, int column, std::vector<meter_series_t> * meters);
+
+/**
+ * Lane order to step every meter at once: meter indices, longest series first (stable), so
+ * that the meters still running at any step are a prefix of the lanes
+ */
+void dataset_lane_order(const std::vector<meter_series_t> & meters, std::vector<int> * order);
+
+/**
+ * Returns the number of lanes of order still running at step
+ * active - lanes running at the previous step, all of them at step 0
+ */
+int dataset_active_lanes(const std::vector<meter_series_t> & meters, const std::vector<int> & order, size_t step,
+                         int active);
+
+#endif //CPP_DATASET_H
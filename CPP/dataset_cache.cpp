@@ -0,0 +1,298 @@
+//
+// Columnar binary cache of a dataset export, memory mapped.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dataset_cache.h"
+
+static const char cache_magic[8] = {'L', 'S', 'T', 'M', 'C', 'O', 'L', 0};
+
+// Column start alignment in the file, one cache line
+#define CACHE_ALIGNMENT 64
+
+struct meter_builder_t {
+    long long square;
+    int country;
+    std::vector<long long> timestamps;
+    std::vector<float> values[DATASET_CACHE_COLUMNS];
+};
+
+/**
+ * Maps a whole file read only, NULL on error or empty file
+ */
+static const unsigned char * map_file(const char * path, size_t * size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat status;
+    if (fstat(fd, &status) < 0 || status.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+    void * map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    *size = status.st_size;
+    return (const unsigned char *) map;
+}
+
+static unsigned long long hash_bytes(const unsigned char * bytes, size_t size) {
+    unsigned long long hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * Same field rules as the text loader: comma separated, empty fields are missing values
+ */
+static unsigned long long parse_csv(const unsigned char * text, size_t size, std::vector<meter_builder_t> * meters) {
+    std::map<std::pair<long long, int>, size_t> index;
+    unsigned long long rows = 0;
+    std::string line;
+
+    for (size_t start = 0; start < size;) {
+        const unsigned char * end = (const unsigned char *) memchr(text + start, '\n', size - start);
+        size_t length = end ? (size_t) (end - (text + start)) : size - start;
+        line.assign((const char *) text + start, length);
+        start += length + 1;
+
+        const char * fields[16];
+        int count = 0;
+        fields[count++] = &line[0];
+        for (char * cursor = &line[0]; *cursor && count < 16; ++cursor) {
+            if (*cursor == ',') {
+                *cursor = 0;
+                fields[count++] = cursor + 1;
+            }
+        }
+        if (count < 3) {
+            continue;
+        }
+
+        long long square = atoll(fields[0]);
+        int country = atoi(fields[2]);
+        std::pair<long long, int> key(square, country);
+        auto found = index.find(key);
+        if (found == index.end()) {
+            found = index.emplace(key, meters->size()).first;
+            meters->push_back(meter_builder_t());
+            meters->back().square = square;
+            meters->back().country = country;
+        }
+        meter_builder_t & meter = (*meters)[found->second];
+        meter.timestamps.push_back((long long) atof(fields[1]));
+
+        for (int c = 0; c < DATASET_CACHE_COLUMNS; ++c) {
+            int field = DATASET_FIRST_VALUE_COLUMN + c;
+            const char * value = field < count ? fields[field] : "";
+            bool missing = value[0] == 0 || value[0] == '\r';
+            meter.values[c].push_back(missing ? 0.0f : (float) atof(value));
+        }
+        rows++;
+    }
+    return rows;
+}
+
+static unsigned long long align(unsigned long long offset) {
+    return (offset + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+}
+
+/**
+ * Appends bytes at offset of image, growing it
+ */
+static void put(std::vector<unsigned char> * image, unsigned long long offset, const void * bytes, size_t size) {
+    if (image->size() < offset + size) {
+        image->resize(offset + size);
+    }
+    if (size) {
+        memcpy(image->data() + offset, bytes, size);
+    }
+}
+
+static int build_cache(const char * cache_path, const unsigned char * csv, size_t csv_size, unsigned long long hash,
+                       long long mtime) {
+    std::vector<meter_builder_t> meters;
+    unsigned long long rows = parse_csv(csv, csv_size, &meters);
+
+    cache_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cache_magic, sizeof(header.magic));
+    header.version = DATASET_CACHE_VERSION;
+    header.meters = (unsigned int) meters.size();
+    header.csv_hash = hash;
+    header.csv_size = csv_size;
+    header.csv_mtime = mtime;
+    header.columns = DATASET_CACHE_COLUMNS;
+    header.rows = rows;
+
+    std::vector<unsigned char> image;
+    std::vector<cache_meter_t> directory(meters.size());
+    unsigned long long offset = align(sizeof(header) + meters.size() * sizeof(cache_meter_t));
+
+    for (size_t m = 0; m < meters.size(); ++m) {
+        const meter_builder_t & meter = meters[m];
+        cache_meter_t & entry = directory[m];
+        memset(&entry, 0, sizeof(entry));
+        entry.square = meter.square;
+        entry.country = meter.country;
+        entry.rows = (int) meter.timestamps.size();
+
+        // One meter's columns are laid out back to back
+        entry.timestamps = offset;
+        put(&image, offset, meter.timestamps.data(), entry.rows * sizeof(long long));
+        offset = align(offset + entry.rows * sizeof(long long));
+
+        for (int c = 0; c < DATASET_CACHE_COLUMNS; ++c) {
+            entry.values[c] = offset;
+            put(&image, offset, meter.values[c].data(), entry.rows * sizeof(float));
+            offset = align(offset + entry.rows * sizeof(float));
+        }
+    }
+    put(&image, 0, &header, sizeof(header));
+    put(&image, sizeof(header), directory.data(), directory.size() * sizeof(cache_meter_t));
+
+    // Written aside then renamed, a concurrent reader never maps a partial file
+    std::string temporary = std::string(cache_path) + ".tmp";
+    FILE * file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return -1;
+    }
+    bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+    written = fclose(file) == 0 && written;
+    if (!written || rename(temporary.c_str(), cache_path) != 0) {
+        remove(temporary.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Tells whether a column of rows elements at offset lies in a file of size bytes, aligned for
+ * its element
+ */
+static bool column_fits(unsigned long long offset, int rows, size_t element, size_t size) {
+    return offset % element == 0 && offset <= size && (unsigned long long) rows <= (size - offset) / element;
+}
+
+/**
+ * Maps cache_path and checks it is a cache of this version, whatever CSV it was built from.
+ * Every column of the directory must lie in the file, a truncated or corrupt cache is rebuilt.
+ */
+static int map_cache(dataset_cache_t * cache, const char * cache_path) {
+    size_t size;
+    const unsigned char * base = map_file(cache_path, &size);
+    if (!base) {
+        return -1;
+    }
+    const cache_header_t * header = (const cache_header_t *) base;
+    bool valid = size >= sizeof(cache_header_t) && memcmp(header->magic, cache_magic, sizeof(cache_magic)) == 0
+                 && header->version == DATASET_CACHE_VERSION && header->columns == DATASET_CACHE_COLUMNS
+                 && header->meters <= (size - sizeof(cache_header_t)) / sizeof(cache_meter_t);
+
+    const cache_meter_t * meters = (const cache_meter_t *) (base + sizeof(cache_header_t));
+    for (unsigned int m = 0; valid && m < header->meters; ++m) {
+        valid = meters[m].rows >= 0 && column_fits(meters[m].timestamps, meters[m].rows, sizeof(long long), size);
+        for (int c = 0; valid && c < DATASET_CACHE_COLUMNS; ++c) {
+            valid = column_fits(meters[m].values[c], meters[m].rows, sizeof(float), size);
+        }
+    }
+    if (!valid) {
+        munmap((void *) base, size);
+        return -1;
+    }
+    cache->base = base;
+    cache->size = size;
+    cache->header = header;
+    cache->meters = meters;
+    return 0;
+}
+
+/**
+ * Records the CSV's new modification time in the cache header, so the next open skips the
+ * hash. A failure only costs that hash again.
+ */
+static void stamp_cache(const dataset_cache_t * cache, const char * cache_path, long long mtime) {
+    cache_header_t header = *cache->header;
+    header.csv_mtime = mtime;
+    int fd = open(cache_path, O_WRONLY);
+    if (fd >= 0) {
+        if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header)) {
+            fprintf(stderr, "Cannot update %s\n", cache_path);
+        }
+        close(fd);
+    }
+}
+
+int dataset_cache_open(dataset_cache_t * cache, const char * csv_path) {
+    struct stat status;
+    if (stat(csv_path, &status) < 0) {
+        return -1;
+    }
+    unsigned long long csv_size = (unsigned long long) status.st_size;
+    long long mtime = (long long) status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+    std::string cache_path = std::string(csv_path) + ".colcache";
+
+    bool mapped = map_cache(cache, cache_path.c_str()) == 0;
+    if (mapped && cache->header->csv_size == csv_size && cache->header->csv_mtime == mtime) {
+        return 0;
+    }
+
+    // Touched, copied or edited: the content decides
+    size_t length;
+    const unsigned char * csv = map_file(csv_path, &length);
+    if (!csv) {
+        if (mapped) {
+            dataset_cache_close(cache);
+        }
+        return -1;
+    }
+    unsigned long long hash = hash_bytes(csv, length);
+    int result = -1;
+    if (mapped && cache->header->csv_size == length && cache->header->csv_hash == hash) {
+        stamp_cache(cache, cache_path.c_str(), mtime);
+        result = 0;
+    } else {
+        if (mapped) {
+            dataset_cache_close(cache);
+        }
+        if (build_cache(cache_path.c_str(), csv, length, hash, mtime) == 0) {
+            result = map_cache(cache, cache_path.c_str());
+        }
+    }
+    munmap((void *) csv, length);
+    return result;
+}
+
+void dataset_cache_close(dataset_cache_t * cache) {
+    if (cache->base) {
+        munmap((void *) cache->base, cache->size);
+    }
+    cache->base = NULL;
+    cache->header = NULL;
+    cache->meters = NULL;
+}
+
+const long long * dataset_cache_timestamps(const dataset_cache_t * cache, int meter) {
+    return (const long long *) (cache->base + cache->meters[meter].timestamps);
+}
+
+const float * dataset_cache_values(const dataset_cache_t * cache, int meter, int column) {
+    return (const float *) (cache->base + cache->meters[meter].values[column - DATASET_FIRST_VALUE_COLUMN]);
+}
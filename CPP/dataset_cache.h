@@ -0,0 +1,66 @@
+//
+// Columnar binary cache of a dataset export, memory mapped.
+//
+// Built next to the CSV as <csv>.colcache on first use. Each meter owns contiguous columns
+// (timestamps, then the five activity values), so a scan of one meter only touches that
+// meter's pages. Missing values are stored as 0, as the text loader reads them.
+//
+// The cache is trusted while the CSV keeps the size and modification time it was built
+// from. Otherwise the CSV is hashed: same content, the cache is stamped with the new time,
+// else it is rebuilt.
+//
+
+#ifndef CPP_DATASET_CACHE_H
+#define CPP_DATASET_CACHE_H
+
+#include <cstddef>
+
+// CSV columns cached: sms in, sms out, call in, call out, internet
+#define DATASET_FIRST_VALUE_COLUMN      3
+#define DATASET_CACHE_COLUMNS           5
+
+#define DATASET_CACHE_VERSION           2
+
+// Offsets are in bytes from the start of the file
+struct cache_meter_t {
+    long long square;
+    int country;
+    int rows;
+    unsigned long long timestamps;                      // rows long long
+    unsigned long long values[DATASET_CACHE_COLUMNS];   // rows float, missing stored as 0
+};
+
+struct cache_header_t {
+    char magic[8];
+    unsigned int version;
+    unsigned int meters;
+    unsigned long long csv_hash;    // FNV-1a 64 of the whole CSV
+    unsigned long long csv_size;
+    long long csv_mtime;            // ns since epoch
+    unsigned int columns;
+    unsigned long long rows;
+};
+
+struct dataset_cache_t {
+    const unsigned char * base;
+    size_t size;
+    const cache_header_t * header;
+    const cache_meter_t * meters;
+};
+
+/**
+ * Maps the cache of csv_path, building or refreshing it first when needed
+ * Returns 0, -1 if the CSV cannot be read or the cache cannot be written
+ */
+int dataset_cache_open(dataset_cache_t * cache, const char * csv_path);
+
+void dataset_cache_close(dataset_cache_t * cache);
+
+const long long * dataset_cache_timestamps(const dataset_cache_t * cache, int meter);
+
+/**
+ * column - CSV column, DATASET_FIRST_VALUE_COLUMN to DATASET_FIRST_VALUE_COLUMN + 4
+ */
+const float * dataset_cache_values(const dataset_cache_t * cache, int meter, int column);
+
+#endif //CPP_DATASET_CACHE_H
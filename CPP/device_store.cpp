@@ -0,0 +1,313 @@
+//
+// Structure of arrays store of the dual prediction state of many devices.
+//
+
+#include <cstdlib>
+#include <cstring>
+
+#include "device_store.h"
+#include "handmade.h"
+
+#define DEVICE_STORE_MAX_FIELDS 12
+
+struct hot_field_t {
+    void ** array;
+    size_t element;             // bytes of one component
+    size_t components;          // per device
+};
+
+/**
+ * Every hot array of the store, so growing and moving slots cannot forget one
+ */
+static int hot_fields(device_store_t * store, hot_field_t * fields) {
+    int count = 0;
+    fields[count++] = {(void **) &store->hidden_layer, sizeof(float), HUNIT};
+    fields[count++] = {(void **) &store->cell_states, sizeof(float), HUNIT};
+    fields[count++] = {(void **) &store->previous, sizeof(float), 1};
+    fields[count++] = {(void **) &store->previous_diff, sizeof(float), 1};
+    fields[count++] = {(void **) &store->sequence, sizeof(uint32_t), 1};
+#ifdef ONLINE_DENSE
+    fields[count++] = {(void **) &store->dense_weights, sizeof(float), HUNIT};
+    fields[count++] = {(void **) &store->dense_bias, sizeof(float), 1};
+    fields[count++] = {(void **) &store->output, sizeof(float), 1};
+#endif
+#ifdef ANOMALY_GATE
+    fields[count++] = {(void **) &store->forecast, sizeof(float), 1};
+    fields[count++] = {(void **) &store->residual_scale, sizeof(float), 1};
+    fields[count++] = {(void **) &store->holding, sizeof(uint8_t), 1};
+#endif
+    return count;
+}
+
+/**
+ * Bytes between two components of a field, a whole number of cache lines
+ */
+static size_t row_bytes(size_t capacity, size_t element) {
+    return (capacity * element + DEVICE_STORE_ALIGNMENT - 1) / DEVICE_STORE_ALIGNMENT * DEVICE_STORE_ALIGNMENT;
+}
+
+void device_store_init(device_store_t * store) {
+    hot_field_t fields[DEVICE_STORE_MAX_FIELDS];
+    int count = hot_fields(store, fields);
+    for (int f = 0; f < count; ++f) {
+        *fields[f].array = NULL;
+    }
+    store->count = 0;
+    store->capacity = 0;
+    store->scaler = model_scaler();
+    store->runtime.arena = NULL;
+    store->cold.clear();
+    store->index.clear();
+}
+
+void device_store_free(device_store_t * store) {
+    hot_field_t fields[DEVICE_STORE_MAX_FIELDS];
+    int count = hot_fields(store, fields);
+    for (int f = 0; f < count; ++f) {
+        free(*fields[f].array);
+        *fields[f].array = NULL;
+    }
+    if (store->runtime.arena) {
+        runtime_destroy(&store->runtime);
+    }
+    store->count = 0;
+    store->capacity = 0;
+    store->cold.clear();
+    store->index.clear();
+}
+
+/**
+ * Reallocates every hot array at capacity, each component row keeping its devices
+ */
+static int grow(device_store_t * store, size_t capacity) {
+    hot_field_t fields[DEVICE_STORE_MAX_FIELDS];
+    int count = hot_fields(store, fields);
+    void * arrays[DEVICE_STORE_MAX_FIELDS];
+
+    for (int f = 0; f < count; ++f) {
+        size_t row = row_bytes(capacity, fields[f].element);
+        if (posix_memalign(&arrays[f], DEVICE_STORE_ALIGNMENT, row * fields[f].components) != 0) {
+            for (int allocated = 0; allocated < f; ++allocated) {
+                free(arrays[allocated]);
+            }
+            return -1;
+        }
+        memset(arrays[f], 0, row * fields[f].components);
+    }
+
+    for (int f = 0; f < count; ++f) {
+        size_t old_row = row_bytes(store->capacity, fields[f].element);
+        size_t row = row_bytes(capacity, fields[f].element);
+        for (size_t k = 0; *fields[f].array && k < fields[f].components; ++k) {
+            memcpy((char *) arrays[f] + k * row, (char *) *fields[f].array + k * old_row,
+                   store->count * fields[f].element);
+        }
+        free(*fields[f].array);
+        *fields[f].array = arrays[f];
+    }
+    store->capacity = capacity;
+    return 0;
+}
+
+int device_store_add(device_store_t * store, const std::string & name) {
+    auto found = store->index.find(name);
+    if (found != store->index.end()) {
+        return (int) found->second;
+    }
+    if (store->count == store->capacity
+        && grow(store, store->capacity ? 2 * store->capacity : DEVICE_STORE_INITIAL) < 0) {
+        return -1;
+    }
+    if (!store->runtime.arena) {
+        // The compiled model, one lane per slot of a device_store_predict pass
+        lstm_model_t model;
+        model_from_parameters(&model);
+        if (runtime_create(&store->runtime, &model, DEVICE_STORE_LANES, 0) < 0) {
+            return -1;
+        }
+    }
+
+    // Hot arrays are zeroed when allocated and when a slot is vacated
+    int slot = (int) store->count++;
+    device_cold_t cold = {};
+    cold.name = name;
+    store->cold.push_back(cold);
+    store->index.emplace(name, (uint32_t) slot);
+    return slot;
+}
+
+int device_store_find(const device_store_t * store, const std::string & name) {
+    auto found = store->index.find(name);
+    return found == store->index.end() ? -1 : (int) found->second;
+}
+
+int device_store_remove(device_store_t * store, const std::string & name) {
+    auto found = store->index.find(name);
+    if (found == store->index.end()) {
+        return -1;
+    }
+    size_t slot = found->second;
+    size_t last = store->count - 1;
+    store->index.erase(found);
+
+    hot_field_t fields[DEVICE_STORE_MAX_FIELDS];
+    int count = hot_fields(store, fields);
+    for (int f = 0; f < count; ++f) {
+        size_t row = row_bytes(store->capacity, fields[f].element);
+        for (size_t k = 0; k < fields[f].components; ++k) {
+            char * base = (char *) *fields[f].array + k * row;
+            if (slot != last) {
+                memcpy(base + slot * fields[f].element, base + last * fields[f].element, fields[f].element);
+            }
+            memset(base + last * fields[f].element, 0, fields[f].element);
+        }
+    }
+    if (slot != last) {
+        store->cold[slot] = store->cold[last];
+        store->index[store->cold[slot].name] = (uint32_t) slot;
+    }
+    store->cold.pop_back();
+    store->count--;
+    return 0;
+}
+
+// The capacity is a power of two of at least DEVICE_STORE_INITIAL, rows need no padding
+static_assert(DEVICE_STORE_INITIAL * sizeof(uint8_t) % DEVICE_STORE_ALIGNMENT == 0, "rows must be whole lines");
+
+void device_store_load(const device_store_t * store, int slot, dual_prediction_t * state) {
+    const size_t stride = store->capacity;
+    for (int k = 0; k < HUNIT; ++k) {
+        state->hidden_layer[k] = store->hidden_layer[k * stride + slot];
+        state->cell_states[k] = store->cell_states[k * stride + slot];
+    }
+    state->scaler = store->scaler;
+    state->differencer.previous = store->previous[slot];
+    state->previous_diff = store->previous_diff[slot];
+    state->sequence = store->sequence[slot];
+#ifdef ONLINE_DENSE
+    for (int k = 0; k < HUNIT; ++k) {
+        state->dense_weights[k] = store->dense_weights[k * stride + slot];
+    }
+    state->dense_bias = store->dense_bias[slot];
+    state->output = store->output[slot];
+#endif
+#ifdef ANOMALY_GATE
+    state->forecast = store->forecast[slot];
+    state->residual_scale = store->residual_scale[slot];
+    state->gated = store->cold[slot].gated;
+    state->holding = store->holding[slot] != 0;
+#endif
+}
+
+void device_store_save(device_store_t * store, int slot, const dual_prediction_t * state) {
+    const size_t stride = store->capacity;
+    for (int k = 0; k < HUNIT; ++k) {
+        store->hidden_layer[k * stride + slot] = state->hidden_layer[k];
+        store->cell_states[k * stride + slot] = state->cell_states[k];
+    }
+    store->previous[slot] = state->differencer.previous;
+    store->previous_diff[slot] = state->previous_diff;
+    store->sequence[slot] = state->sequence;
+#ifdef ONLINE_DENSE
+    for (int k = 0; k < HUNIT; ++k) {
+        store->dense_weights[k * stride + slot] = state->dense_weights[k];
+    }
+    store->dense_bias[slot] = state->dense_bias;
+    store->output[slot] = state->output;
+#endif
+#ifdef ANOMALY_GATE
+    store->forecast[slot] = state->forecast;
+    store->residual_scale[slot] = state->residual_scale;
+    store->cold[slot].gated = state->gated;
+    store->holding[slot] = state->holding ? 1 : 0;
+#endif
+}
+
+void device_store_restart(device_store_t * store, int slot, float first_value, uint32_t sequence) {
+    dual_prediction_t state;
+    dual_prediction_init(&state, first_value, sequence);
+    device_store_save(store, slot, &state);
+}
+
+void device_store_predict(device_store_t * store, const int * slots, int count, float * forecasts) {
+    runtime_t * runtime = &store->runtime;
+    const size_t stride = store->capacity;
+    float inputs[DEVICE_STORE_LANES];
+    float outputs[DEVICE_STORE_LANES];
+
+    for (int first = 0; first < count; first += DEVICE_STORE_LANES) {
+        const int * lanes = slots + first;
+        const int width = count - first < DEVICE_STORE_LANES ? count - first : DEVICE_STORE_LANES;
+
+        // Rows of the batch into the runtime's lanes
+        for (int k = 0; k < width; ++k) {
+            float * hidden_layer = runtime->hidden_layer + k * HUNIT;
+            float * cell_states = runtime->cell_states + k * HUNIT;
+            for (int i = 0; i < HUNIT; ++i) {
+                hidden_layer[i] = store->hidden_layer[i * stride + lanes[k]];
+                cell_states[i] = store->cell_states[i * stride + lanes[k]];
+            }
+#ifdef MODEL_SCALER_FOLDED
+            inputs[k] = store->previous_diff[lanes[k]];
+#else
+            inputs[k] = scale_value(&store->scaler, store->previous_diff[lanes[k]]);
+#endif
+        }
+
+        runtime_step(runtime, 0, width, inputs, outputs);
+
+        for (int k = 0; k < width; ++k) {
+            const int slot = lanes[k];
+            const float * hidden_layer = runtime->hidden_layer + k * HUNIT;
+            const float * cell_states = runtime->cell_states + k * HUNIT;
+            for (int i = 0; i < HUNIT; ++i) {
+                store->hidden_layer[i * stride + slot] = hidden_layer[i];
+                store->cell_states[i * stride + slot] = cell_states[i];
+            }
+
+#ifdef ONLINE_DENSE
+            // The device's own head instead of the runtime's
+            float weights[HUNIT];
+            for (int i = 0; i < HUNIT; ++i) {
+                weights[i] = store->dense_weights[i * stride + slot];
+            }
+            float y_diff_scaled = dense_nn(hidden_layer, weights, store->dense_bias[slot]);
+            store->output[slot] = y_diff_scaled;
+#else
+            float y_diff_scaled = outputs[k];
+#endif
+#ifdef MODEL_SCALER_FOLDED
+            float y_diff = y_diff_scaled;
+#else
+            float y_diff = invert_scale_value(&store->scaler, y_diff_scaled);
+#endif
+            // Same order as invert_difference
+            forecasts[first + k] = y_diff + store->previous[slot];
+#ifdef ANOMALY_GATE
+            store->forecast[slot] = forecasts[first + k];
+#endif
+        }
+    }
+}
+
+void device_store_commit(device_store_t * store, int slot, float value) {
+#ifdef ANOMALY_GATE
+    store->holding[slot] = 0;
+#endif
+    // Same as difference_push
+    store->previous_diff[slot] = value - store->previous[slot];
+    store->previous[slot] = value;
+    store->sequence[slot]++;
+}
+
+void device_store_correct(device_store_t * store, int slot, float value) {
+#if defined(ONLINE_DENSE) || defined(ANOMALY_GATE)
+    // Both adapt per device state on a correction, left to dual_prediction_correct
+    dual_prediction_t state;
+    device_store_load(store, slot, &state);
+    dual_prediction_correct(&state, value);
+    device_store_save(store, slot, &state);
+#else
+    device_store_commit(store, slot, value);
+#endif
+}
@@ -0,0 +1,129 @@
+//
+// Structure of arrays store of the dual prediction state of many devices.
+//
+// Fields stepped on every sample (h, c, last value, last difference, sequence and the
+// ONLINE_DENSE / ANOMALY_GATE state) each live in their own 64 byte aligned array, vectors
+// component-major (component k of every device, then k + 1), so a batch of devices walks
+// contiguous memory. Bookkeeping read once per uplink (id, counters) is kept apart, and the
+// scaler, the same for every device, is stored once. device_store_predict steps a batch of
+// slots with the batched kernel of runtime.h, the rows gathered into its lanes and scattered
+// back; device_store_load / device_store_save move one slot in and out of a dual_prediction_t
+// for everything else.
+//
+// Slots are dense: removing a device moves the last one into its slot.
+//
+
+#ifndef CPP_DEVICE_STORE_H
+#define CPP_DEVICE_STORE_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dual_prediction.h"
+#include "runtime.h"
+
+#define DEVICE_STORE_ALIGNMENT  64
+
+// Capacity of the first allocation, doubled when full
+#define DEVICE_STORE_INITIAL    64
+
+// Slots stepped together by device_store_predict, the rest of a batch follows in as many passes
+#define DEVICE_STORE_LANES      64
+
+struct device_cold_t {
+    std::string name;
+    bool started;
+    bool diverged;              // a frame was lost, only transmitted values are rebuilt until a restart
+    uint32_t corrections;       // transmitted samples applied
+    uint32_t forecasts;         // skipped samples filled with the model
+#ifdef ANOMALY_GATE
+    uint32_t gated;
+#endif
+};
+
+struct device_store_t {
+    size_t count;
+    size_t capacity;
+    scaler_t scaler;
+
+    // Hot, [capacity] or [HUNIT][capacity]
+    float * hidden_layer;
+    float * cell_states;
+    float * previous;
+    float * previous_diff;
+    uint32_t * sequence;
+    runtime_t runtime;          // DEVICE_STORE_LANES lanes of the compiled model, from the first add
+#ifdef ONLINE_DENSE
+    float * dense_weights;
+    float * dense_bias;
+    float * output;
+#endif
+#ifdef ANOMALY_GATE
+    float * forecast;
+    float * residual_scale;
+    uint8_t * holding;
+#endif
+
+    // Cold
+    std::vector<device_cold_t> cold;
+    std::unordered_map<std::string, uint32_t> index;    // device id -> slot
+};
+
+void device_store_init(device_store_t * store);
+
+void device_store_free(device_store_t * store);
+
+/**
+ * Slot of a device, added with a zero state and not started on first use
+ * Returns the slot, -1 on allocation failure
+ */
+int device_store_add(device_store_t * store, const std::string & name);
+
+/**
+ * Returns the slot of a device, -1 if unknown
+ */
+int device_store_find(const device_store_t * store, const std::string & name);
+
+/**
+ * Forgets a device, the last slot is moved into its place
+ * Returns 0, -1 if unknown
+ */
+int device_store_remove(device_store_t * store, const std::string & name);
+
+/**
+ * Copies the state of a slot out into a dual prediction state
+ */
+void device_store_load(const device_store_t * store, int slot, dual_prediction_t * state);
+
+/**
+ * Copies a dual prediction state back into a slot
+ */
+void device_store_save(device_store_t * store, int slot, const dual_prediction_t * state);
+
+/**
+ * dual_prediction_init of a slot
+ */
+void device_store_restart(device_store_t * store, int slot, float first_value, uint32_t sequence);
+
+/**
+ * dual_prediction_predict of every slot in slots[0..count-1], a slot at most once: the rows
+ * go through runtime_step DEVICE_STORE_LANES at a time. runtime_step keeps the evaluation
+ * order of lstmCellSimple/dense_nn, as replay -k runtime checks against the conformance hash,
+ * so the forecasts and states are bit-identical to dual_prediction_predict.
+ * forecasts - count values, forecasts[k] of slots[k]
+ */
+void device_store_predict(device_store_t * store, const int * slots, int count, float * forecasts);
+
+/**
+ * dual_prediction_commit of a slot, after device_store_predict
+ */
+void device_store_commit(device_store_t * store, int slot, float value);
+
+/**
+ * dual_prediction_correct of a slot, after device_store_predict
+ */
+void device_store_correct(device_store_t * store, int slot, float value);
+
+#endif //CPP_DEVICE_STORE_H
@@ -0,0 +1,120 @@
+//
+// Evaluation of several models on every meter in one pass, and per meter model selection.
+//
+
+#include <cstring>
+
+#include "ensemble.h"
+#include "node_sample.h"
+#include "runtime.h"
+
+int ensemble_bucket(long long timestamp, int buckets) {
+    long long seconds = timestamp / 1000 + ENSEMBLE_UTC_OFFSET_S;
+    long long of_day = ((seconds % 86400) + 86400) % 86400;
+    return (int) (of_day * buckets / 86400);
+}
+
+float ensemble_skip_rate(const ensemble_score_t * score, int bucket) {
+    int samples = bucket < 0 ? score->samples : score->bucket_samples[bucket];
+    int transmitted = bucket < 0 ? score->transmitted : score->bucket_transmitted[bucket];
+    return samples ? 1.0f - (float) transmitted / (float) samples : 0.0f;
+}
+
+int ensemble_evaluate(const lstm_model_t * models, int model_count, const std::vector<meter_series_t> & meters,
+                      float threshold, int buckets, ensemble_score_t * scores) {
+    const int lanes = (int) meters.size();
+    if (lanes == 0 || buckets < 1 || buckets > ENSEMBLE_MAX_BUCKETS) {
+        return lanes == 0 ? 0 : -1;
+    }
+    memset(scores, 0, lanes * model_count * sizeof(ensemble_score_t));
+
+    std::vector<int> order;
+    dataset_lane_order(meters, &order);
+
+    std::vector<runtime_t> runtimes(model_count);
+    for (int m = 0; m < model_count; ++m) {
+        if (runtime_create(&runtimes[m], &models[m], lanes, 0) < 0) {
+            for (int created = 0; created < m; ++created) {
+                runtime_destroy(&runtimes[created]);
+            }
+            return -1;
+        }
+    }
+
+    // Shared by every model: the reading and its bucket
+    std::vector<float> measured(lanes);
+    std::vector<int> bucket(lanes);
+    // Per model and lane: reconstructed series
+    std::vector<float> previous(model_count * lanes, 0.0f);
+    std::vector<float> previous_diff(model_count * lanes, 0.0f);
+    std::vector<float> inputs(lanes);
+    std::vector<float> outputs(lanes);
+
+    const size_t steps = meters[order[0]].values.size();
+    int active = lanes;
+    for (size_t i = 0; i < steps; ++i) {
+        active = dataset_active_lanes(meters, order, i, active);
+        for (int lane = 0; lane < active; ++lane) {
+            const meter_series_t & meter = meters[order[lane]];
+            measured[lane] = meter.values[i];
+            bucket[lane] = ensemble_bucket(meter.timestamps[i], buckets);
+        }
+
+        for (int m = 0; m < model_count; ++m) {
+            const lstm_model_t & model = models[m];
+            float * model_previous = &previous[m * lanes];
+            float * model_previous_diff = &previous_diff[m * lanes];
+
+            if (i > 0) {
+                for (int lane = 0; lane < active; ++lane) {
+                    inputs[lane] = model.scaler_folded ? model_previous_diff[lane]
+                                                       : scale_value(&model.scaler, model_previous_diff[lane]);
+                }
+                runtime_step(&runtimes[m], 0, active, inputs.data(), outputs.data());
+            }
+
+            for (int lane = 0; lane < active; ++lane) {
+                float forecast = 0;
+                if (i > 0) {
+                    float y_diff = model.scaler_folded ? outputs[lane] : invert_scale_value(&model.scaler, outputs[lane]);
+                    forecast = model_previous[lane] + y_diff;
+                }
+                node_sample_t sample;
+                node_sample_decide(&sample, i == 0, measured[lane], forecast, threshold);
+                model_previous_diff[lane] = i > 0 ? sample.value - model_previous[lane] : 0;
+                model_previous[lane] = sample.value;
+
+                ensemble_score_t * score = &scores[order[lane] * model_count + m];
+                score->samples++;
+                score->bucket_samples[bucket[lane]]++;
+                score->transmitted += sample.transmitted;
+                score->bucket_transmitted[bucket[lane]] += sample.transmitted;
+            }
+        }
+    }
+
+    for (int m = 0; m < model_count; ++m) {
+        runtime_destroy(&runtimes[m]);
+    }
+    return 0;
+}
+
+int ensemble_select(const ensemble_score_t * scores, const size_t * model_bytes, int model_count, int bucket,
+                    float target, bool * met) {
+    int smallest = -1;
+    int best = 0;
+    for (int m = 0; m < model_count; ++m) {
+        float rate = ensemble_skip_rate(&scores[m], bucket);
+        if (rate >= target && (smallest < 0 || model_bytes[m] < model_bytes[smallest]
+                               || (model_bytes[m] == model_bytes[smallest]
+                                   && rate > ensemble_skip_rate(&scores[smallest], bucket)))) {
+            smallest = m;
+        }
+        float best_rate = ensemble_skip_rate(&scores[best], bucket);
+        if (rate > best_rate || (rate == best_rate && model_bytes[m] < model_bytes[best])) {
+            best = m;
+        }
+    }
+    *met = smallest >= 0;
+    return smallest >= 0 ? smallest : best;
+}
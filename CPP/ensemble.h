@@ -0,0 +1,59 @@
+//
+// Evaluation of several models on every meter in one pass, and per meter model selection.
+//
+// All models replay the node's dual prediction on all meters together: each model owns a
+// runtime (runtime.h) with one lane per meter, the readings and their transmitted values are
+// prepared once per sample and shared by every model. Transmissions are counted over the
+// whole series and per time-of-day bucket, so a meter can be given the smallest model that
+// reaches its skip rate target, overall or within each part of the day.
+//
+
+#ifndef CPP_ENSEMBLE_H
+#define CPP_ENSEMBLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+
+// The Telecom Italia export is in Milan time (CET, UTC+1, no DST over Nov-Dec 2013)
+#define ENSEMBLE_UTC_OFFSET_S           3600
+
+#define ENSEMBLE_MAX_BUCKETS            24
+
+struct ensemble_score_t {
+    int samples;
+    int transmitted;
+    int bucket_samples[ENSEMBLE_MAX_BUCKETS];
+    int bucket_transmitted[ENSEMBLE_MAX_BUCKETS];
+};
+
+/**
+ * Time-of-day bucket of a timestamp (ms), 0 to buckets - 1, bucket 0 starting at midnight
+ */
+int ensemble_bucket(long long timestamp, int buckets);
+
+/**
+ * Skip rate of a score, over bucket or the whole series for bucket -1. 0 without samples.
+ */
+float ensemble_skip_rate(const ensemble_score_t * score, int bucket);
+
+/**
+ * Replays every model on every meter with a fixed threshold, as model_replay does
+ * scores - meters.size() * model_count scores, the one of meter i and model m at i * model_count + m
+ * Returns 0, -1 if a model cannot be run
+ */
+int ensemble_evaluate(const lstm_model_t * models, int model_count, const std::vector<meter_series_t> & meters,
+                      float threshold, int buckets, ensemble_score_t * scores);
+
+/**
+ * Smallest model, by model_bytes, whose skip rate over bucket (-1 for the whole series)
+ * reaches target on that meter. Without one, the model with the highest skip rate.
+ * scores - the model_count scores of the meter
+ * met - set to whether the target is reached
+ */
+int ensemble_select(const ensemble_score_t * scores, const size_t * model_bytes, int model_count, int bucket,
+                    float target, bool * met);
+
+#endif //CPP_ENSEMBLE_H
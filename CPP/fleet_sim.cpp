@@ -0,0 +1,435 @@
+//
+// Discrete event simulation of a fleet of nodes, one gateway and the server mirror.
+//
+// fleet_sim [-n nodes] [-x samples per node] [-p sample period in s] [-t threshold]
+//           [-r data rate] [-a] [-s snr] [-l batch latency]
+//
+// Every node runs the control flow of ../MBED/main.cpp (sample_tick, send_message, TX_DONE
+// and duty cycle retries) as a small state machine resumed by events of a single virtual
+// clock, so a million nodes are a million structs and a heap of pending events, not threads.
+// Nodes read conso_data cyclically, each from its own offset, with sampling phases spread
+// over the period. The gateway listens on the three EU868 default channels: two frames
+// overlapping on the same channel and data rate are both lost. Received frames are decoded
+// and fed to the mirror (mirror.h), which is then checked against the nodes: every node none
+// of whose frames was lost must have the very same reconstructed series on both sides, and
+// every node with a frame delivered after a lost one must have been flagged diverged. A run
+// leaving no node without loss has nothing to compare and fails too.
+//
+// Defaults are a day of 10000 nodes sampling every 10 min, a load one gateway carries. At the
+// firmware's SAMPLE_PERIOD (-p 7) such a fleet saturates the gateway and nearly every frame
+// collides.
+//
+// The nodes are explicit state machines, not C++20 coroutines: main.cpp itself is a set of
+// event handlers on an event queue, which the states map one to one, and a node stays a
+// fixed size struct instead of a heap allocated coroutine frame, with the rest of the tools
+// on C++11.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "conformance.h"
+#include "conso_data.h"
+#include "lora_sim.h"
+#include "mirror.h"
+#include "node_config.h"
+#include "node_sample.h"
+#include "payload.h"
+#include "uplink_batch.h"
+
+// EU868 default channels every node hops over
+#define FLEET_CHANNELS 3
+
+// Records queued before the mirror steps
+#define FLEET_MIRROR_BATCH 4096
+
+// Default fleet: nodes, samples per node and sample period in s
+#define FLEET_NODES     10000
+#define FLEET_SAMPLES   144
+#define FLEET_PERIOD    600
+
+enum node_state_t {
+    NODE_IDLE,                  // sleeping until the next sample tick
+    NODE_TX,                    // waiting for TX_DONE
+    NODE_BACKOFF,               // send() refused by the duty cycle, waiting for the retry
+};
+
+enum event_kind_t {
+    EVENT_SAMPLE,
+    EVENT_TX_DONE,
+    EVENT_RETRY,
+    EVENT_FRAME_END,            // a frame finishes arriving at the gateway
+};
+
+struct event_t {
+    double time;
+    uint32_t target;            // node, or frame for EVENT_FRAME_END
+    uint32_t kind;
+
+    bool operator>(const event_t & other) const {
+        if (time != other.time) {
+            return time > other.time;
+        }
+        return kind != other.kind ? kind > other.kind : target > other.target;
+    }
+};
+
+struct fleet_node_t {
+    dual_prediction_t prediction;
+    uplink_batch_t batch;
+    lora_radio_t radio;
+    node_state_t state;
+    uint32_t sequence;
+    uint32_t skipped;
+    uint32_t offset;            // position in conso_data of sample 0
+    uint32_t hash;              // FNV-1a of every reconstructed value so far
+    uint32_t record_hash;       // hash as of the last correction added to the batch
+    int max_payload;
+    bool model_version_sent;
+};
+
+struct frame_t {
+    uint32_t node;
+    int channel;
+    int data_rate;
+    bool collided;
+    bool lost;                  // below the demodulation floor (ADR link model)
+    uint32_t hash;              // node hash as of the frame's last record
+    int length;
+    uint8_t data[BATCH_MAX_SIZE];
+};
+
+struct fleet_t {
+    std::vector<fleet_node_t> nodes;
+    std::priority_queue<event_t, std::vector<event_t>, std::greater<event_t> > events;
+    double period;
+    float threshold;
+    uint32_t max_latency;
+
+    // Gateway
+    std::vector<frame_t> frames;
+    std::vector<uint32_t> free_frames;
+    std::vector<uint32_t> on_air[FLEET_CHANNELS][EU868_MAX_ADR_DR + 1];
+    long sent;
+    long collided;
+    long lost;
+    long delivered;
+    double airtime;
+
+    // Server
+    mirror_t mirror;
+    std::vector<uint32_t> mirror_hash;      // per node, FNV-1a of the mirror's series
+    std::vector<uint32_t> expected_hash;    // per node, hash of the last delivered frame
+    std::vector<unsigned char> missed;      // per node, a frame was lost
+    std::vector<unsigned char> resumed;     // per node, a frame arrived after a lost one
+    double mirror_ms;
+    long records;
+    long forecasts;                         // samples the mirror filled with the model
+
+    long samples;
+    long corrections;
+    long dropped;
+};
+
+static void schedule(fleet_t * fleet, double time, uint32_t target, event_kind_t kind) {
+    event_t event = {time, target, (uint32_t) kind};
+    fleet->events.push(event);
+}
+
+static void mirror_emit(void * context, int device, uint32_t sequence, float value, bool transmitted) {
+    (void) sequence;
+    fleet_t * fleet = (fleet_t *) context;
+    fleet->forecasts += !transmitted;
+    fleet->mirror_hash[device] = conformance_hash_float(fleet->mirror_hash[device], value);
+}
+
+static void mirror_flush(fleet_t * fleet) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mirror_step(&fleet->mirror);
+    fleet->mirror_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * send_message(): hands the batch to the radio, or waits for the band to reopen
+ */
+static void send_message(fleet_t * fleet, uint32_t id, double now) {
+    fleet_node_t * node = &fleet->nodes[id];
+    if (node->batch.count == 0 || node->state != NODE_IDLE) {
+        return;
+    }
+
+    long lost = node->radio.lost;
+    int data_rate = node->radio.data_rate;
+    double done;
+    if (lora_send(&node->radio, now, node->batch.length, &done) < 0) {
+        node->state = NODE_BACKOFF;
+        schedule(fleet, now + (done > 0 ? done : TX_RETRY_DELAY / 1000.0), id, EVENT_RETRY);
+        return;
+    }
+
+    // The frame goes on air on the next channel of the node's hopping sequence
+    uint32_t index;
+    if (fleet->free_frames.empty()) {
+        index = (uint32_t) fleet->frames.size();
+        fleet->frames.resize(index + 1);
+    } else {
+        index = fleet->free_frames.back();
+        fleet->free_frames.pop_back();
+    }
+    frame_t * frame = &fleet->frames[index];
+    frame->node = id;
+    frame->channel = (int) ((id + node->radio.frames) % FLEET_CHANNELS);
+    frame->data_rate = data_rate;
+    frame->collided = false;
+    frame->lost = node->radio.lost != lost;
+    frame->hash = node->record_hash;
+    frame->length = node->batch.length;
+    memcpy(frame->data, node->batch.buffer, node->batch.length);
+
+    std::vector<uint32_t> & on_air = fleet->on_air[frame->channel][data_rate];
+    if (!on_air.empty()) {
+        frame->collided = true;
+        for (uint32_t other : on_air) {
+            fleet->frames[other].collided = true;
+        }
+    }
+    on_air.push_back(index);
+
+    const lora_data_rate_t & rate = eu868_data_rates[data_rate];
+    double time_on_air = lora_time_on_air(rate.spreading_factor, rate.bandwidth_khz,
+                                          node->batch.length + LORAWAN_OVERHEAD);
+    fleet->airtime += time_on_air;
+    fleet->sent++;
+    schedule(fleet, now + time_on_air, index, EVENT_FRAME_END);
+
+    batch_reset(&node->batch);
+    node->model_version_sent = true;
+    node->state = NODE_TX;
+    schedule(fleet, done, id, EVENT_TX_DONE);
+}
+
+static void tx_done(fleet_t * fleet, uint32_t id, double now) {
+    fleet_node_t * node = &fleet->nodes[id];
+    node->state = NODE_IDLE;
+    node->max_payload = eu868_max_payload(node->radio.data_rate);
+    if (batch_due(&node->batch, node->sequence, fleet->max_latency, node->max_payload)) {
+        send_message(fleet, id, now);
+    }
+}
+
+/**
+ * Where a full batch is sent from
+ */
+struct flush_t {
+    fleet_t * fleet;
+    uint32_t id;
+    double now;
+};
+
+static void flush_batch(void * context) {
+    flush_t * flush = (flush_t *) context;
+    send_message(flush->fleet, flush->id, flush->now);
+}
+
+static void sample_tick(fleet_t * fleet, uint32_t id, double now) {
+    fleet_node_t * node = &fleet->nodes[id];
+    const uint32_t length = sizeof(conso_data) / sizeof(conso_data[0]);
+    float measured = conso_data[(node->offset + node->sequence) % length];
+    flush_t flush = {fleet, id, now};
+    node_uplink_t uplink = {&node->batch, node->max_payload, !node->model_version_sent, &node->skipped,
+                            flush_batch, &flush};
+    node_sample_t sample;
+    int status = node_sample_step(&node->prediction, node->sequence, measured, fleet->threshold, &uplink, &sample);
+    fleet->dropped += status < 0;
+    fleet->corrections += status > 0;
+
+    node->hash = conformance_hash_float(node->hash, sample.value);
+    if (sample.transmitted) {
+        node->record_hash = node->hash;
+    }
+    node->sequence++;
+    fleet->samples++;
+
+    if (batch_due(&node->batch, node->sequence, fleet->max_latency, node->max_payload)) {
+        send_message(fleet, id, now);
+    }
+}
+
+/**
+ * A frame has fully arrived: the gateway decodes it unless it collided or faded
+ */
+static void frame_end(fleet_t * fleet, uint32_t index) {
+    frame_t * frame = &fleet->frames[index];
+    std::vector<uint32_t> & on_air = fleet->on_air[frame->channel][frame->data_rate];
+    for (size_t i = 0; i < on_air.size(); ++i) {
+        if (on_air[i] == index) {
+            on_air[i] = on_air.back();
+            on_air.pop_back();
+            break;
+        }
+    }
+
+    if (frame->collided || frame->lost) {
+        fleet->collided += frame->collided;
+        fleet->lost += !frame->collided;
+        fleet->missed[frame->node] = 1;
+    } else {
+        uplink_t records[BATCH_MAX_SIZE / 2];
+        int count = payload_decode_batch(frame->data, frame->length, records, BATCH_MAX_SIZE / 2);
+        for (int i = 0; i < count; ++i) {
+            mirror_push(&fleet->mirror, (int) frame->node, &records[i]);
+        }
+        fleet->delivered++;
+        fleet->resumed[frame->node] |= fleet->missed[frame->node];
+        fleet->records += count > 0 ? count : 0;
+        fleet->expected_hash[frame->node] = frame->hash;
+        if (fleet->mirror.pending.size() >= FLEET_MIRROR_BATCH) {
+            mirror_flush(fleet);
+        }
+    }
+    fleet->free_frames.push_back(index);
+}
+
+int main(int argc, char ** argv) {
+    long node_count = FLEET_NODES;
+    long samples = FLEET_SAMPLES;
+    double period = FLEET_PERIOD;
+    float threshold = 0.3f;
+    int data_rate = 5;
+    bool adr = false;
+    float snr = 0.0f;
+    int latency = BATCH_MAX_LATENCY;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-a")) {
+            adr = true;
+        } else if (i + 1 < argc && !strcmp(argv[i], "-n")) {
+            node_count = atol(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-x")) {
+            samples = atol(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-p")) {
+            period = atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+            threshold = (float) atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-r")) {
+            data_rate = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+            snr = (float) atof(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-l")) {
+            latency = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: fleet_sim [-n nodes] [-x samples per node] [-p sample period in s] "
+                            "[-t threshold] [-r data rate] [-a] [-s snr] [-l batch latency]\n");
+            return 1;
+        }
+    }
+    if (data_rate < 0 || data_rate > EU868_MAX_ADR_DR || period <= 0 || node_count < 1 || samples < 1
+        || latency < 0) {
+        fprintf(stderr, "Data rate must be 0 to %d, other values positive\n", EU868_MAX_ADR_DR);
+        return 1;
+    }
+
+    static fleet_t fleet;
+    fleet.period = period;
+    fleet.threshold = threshold;
+    fleet.max_latency = (uint32_t) latency;
+    fleet.nodes.resize(node_count);
+    fleet.mirror_hash.assign(node_count, CONFORMANCE_HASH_SEED);
+    fleet.expected_hash.assign(node_count, CONFORMANCE_HASH_SEED);
+    fleet.missed.assign(node_count, 0);
+    fleet.resumed.assign(node_count, 0);
+    mirror_init(&fleet.mirror, mirror_emit, &fleet);
+
+    const uint32_t length = sizeof(conso_data) / sizeof(conso_data[0]);
+    for (long id = 0; id < node_count; ++id) {
+        fleet_node_t * node = &fleet.nodes[id];
+        batch_reset(&node->batch);
+        lora_init(&node->radio, data_rate, adr, snr, 3.0f, (unsigned int) id + 1);
+        node->state = NODE_IDLE;
+        node->sequence = 0;
+        node->skipped = 0;
+        node->offset = (uint32_t) (id % length);
+        node->hash = CONFORMANCE_HASH_SEED;
+        node->record_hash = node->hash;
+        node->max_payload = eu868_max_payload(data_rate);
+        node->model_version_sent = false;
+        mirror_device(&fleet.mirror, "node-" + std::to_string(id));
+        schedule(&fleet, period * id / node_count, (uint32_t) id, EVENT_SAMPLE);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const double end = samples * period;
+    long events = 0;
+    double now = 0;
+    while (!fleet.events.empty()) {
+        event_t event = fleet.events.top();
+        fleet.events.pop();
+        now = event.time;
+        events++;
+        switch (event.kind) {
+            case EVENT_SAMPLE:
+                sample_tick(&fleet, event.target, now);
+                if (now + period < end) {
+                    schedule(&fleet, now + period, event.target, EVENT_SAMPLE);
+                }
+                break;
+            case EVENT_TX_DONE:
+                tx_done(&fleet, event.target, now);
+                break;
+            case EVENT_RETRY:
+                fleet.nodes[event.target].state = NODE_IDLE;
+                send_message(&fleet, event.target, now);
+                break;
+            default:
+                frame_end(&fleet, event.target);
+                break;
+        }
+    }
+    mirror_flush(&fleet);
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Nodes whose frames all arrived must agree with the mirror up to their last delivered record.
+    // The mirror must have flagged exactly the nodes with a frame delivered after a lost one,
+    // the only losses it can see.
+    long complete = 0;
+    long in_step = 0;
+    long lossy = 0;
+    long flagged = 0;
+    long misflagged = 0;
+    for (long id = 0; id < node_count; ++id) {
+        bool diverged = fleet.mirror.store.cold[id].diverged;
+        if (!fleet.missed[id]) {
+            complete++;
+            in_step += fleet.mirror_hash[id] == fleet.expected_hash[id] && !diverged;
+        }
+        lossy += fleet.resumed[id];
+        flagged += fleet.resumed[id] && diverged;
+        misflagged += !fleet.resumed[id] && diverged;
+    }
+
+    printf("%ld nodes, %ld samples, %.1f h simulated, %ld events in %.1f ms (%.2f M events/s), %zu bytes per node\n",
+           node_count, fleet.samples, now / 3600.0, events, elapsed_ms,
+           elapsed_ms > 0 ? events / elapsed_ms / 1000.0 : 0.0, sizeof(fleet_node_t));
+    printf("Corrections %ld (%.2f%%), dropped %ld\n", fleet.corrections,
+           100.0 * fleet.corrections / fleet.samples, fleet.dropped);
+    printf("Gateway: %ld frames sent, %ld collided, %ld lost, %ld delivered, channel load %.2f%%\n",
+           fleet.sent, fleet.collided, fleet.lost, fleet.delivered,
+           now > 0 ? 100.0 * fleet.airtime / (FLEET_CHANNELS * now) : 0.0);
+    printf("Mirror: %ld records in %.1f ms (%.2f M records/s), %ld samples forecast, %llu resyncs, "
+           "%ld of %ld nodes without loss in step\n",
+           fleet.records, fleet.mirror_ms, fleet.mirror_ms > 0 ? fleet.records / fleet.mirror_ms / 1000.0 : 0.0,
+           fleet.forecasts, (unsigned long long) fleet.mirror.resyncs, in_step, complete);
+    printf("Mirror: %llu lost frames detected, %ld of %ld nodes with a loss flagged diverged, %ld flagged wrongly\n",
+           (unsigned long long) fleet.mirror.lost_frames, flagged, lossy, misflagged);
+    if (complete == 0) {
+        printf("Every node lost a frame, nothing to check the mirror against: lower the load (-n, -p)\n");
+        return 2;
+    }
+    return in_step == complete && flagged == lossy && misflagged == 0 ? 0 : 2;
+}
@@ -0,0 +1,60 @@
+//
+// Export pass folding the scaler into the weights.
+//
+// fold_scaler input.h output.h
+//
+// Writes a parameters.h with MODEL_SCALER_FOLDED and checks its forecasts over conso_data
+// against the unfused model.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "conso_data.h"
+#include "model.h"
+
+int main(int argc, char ** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: fold_scaler input.h output.h\n");
+        return 1;
+    }
+
+    lstm_model_t model;
+    if (model_load(&model, argv[1]) < 0) {
+        return 1;
+    }
+    if (model.scaler_folded) {
+        fprintf(stderr, "%s is already folded\n", argv[1]);
+        return 1;
+    }
+
+    lstm_model_t folded = model;
+    model_fold_scaler(&folded);
+    folded.version = model.version + 1;
+
+    // Verification against the unfused path
+    int length = sizeof(conso_data) / sizeof(conso_data[0]);
+    std::vector<float> reference(length);
+    std::vector<float> forecast(length);
+    model_forecast_series(&model, conso_data, reference.data(), length);
+    model_forecast_series(&folded, conso_data, forecast.data(), length);
+
+    double max_error = 0;
+    double max_relative = 0;
+    for (int i = 1; i < length; ++i) {
+        double error = fabs((double) forecast[i] - reference[i]);
+        max_error = fmax(max_error, error);
+        max_relative = fmax(max_relative, error / fmax(fabs((double) reference[i]), 1.0));
+    }
+    printf("Folded model max deviation over %d forecasts: %g absolute, %g relative\n",
+           length - 1, max_error, max_relative);
+
+    // Far above float rounding, the fold is wrong
+    if (max_relative > 1e-4) {
+        fprintf(stderr, "Folded model diverges from the unfused one, not written\n");
+        return 2;
+    }
+
+    return model_save(&folded, argv[2]) < 0 ? 1 : 0;
+}
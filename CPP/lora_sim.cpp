@@ -0,0 +1,157 @@
+//
+// Host model of the node's LoRaWAN radio: EU868 time on air, band duty cycle and ADR.
+//
+
+#include <cmath>
+
+#include "lora_sim.h"
+
+// RECEIVE_DELAY1 and RECEIVE_DELAY2 of the EU868 regional parameters, in s
+#define RX1_DELAY               1.0
+#define RX2_DELAY               2.0
+
+// Symbols a receive window stays open for when nothing is received
+#define RX_WINDOW_SYMBOLS       6
+
+// RX2 default data rate (DR0)
+#define RX2_DATA_RATE           0
+
+// Margin the network server keeps above the demodulation floor (TTN installation margin)
+#define ADR_MARGIN_DB           10.0f
+
+const lora_data_rate_t eu868_data_rates[] = {
+    {12, 125, -20.0f},
+    {11, 125, -17.5f},
+    {10, 125, -15.0f},
+    {9, 125, -12.5f},
+    {8, 125, -10.0f},
+    {7, 125, -7.5f},
+    {7, 250, -7.5f},
+};
+
+double lora_time_on_air(int spreading_factor, int bandwidth_khz, int phy_payload) {
+    double symbol = (double) (1 << spreading_factor) / (bandwidth_khz * 1000.0);
+    // Low data rate optimisation is mandated when a symbol lasts more than 16 ms
+    int low_data_rate = symbol > 0.016 ? 1 : 0;
+    const int coding_rate = 1;     // 4/5
+    const int preamble = 8;
+
+    double numerator = 8.0 * phy_payload - 4.0 * spreading_factor + 28 + 16;
+    double payload_symbols = 8 + fmax(ceil(numerator / (4.0 * (spreading_factor - 2 * low_data_rate)))
+                                      * (coding_rate + 4), 0.0);
+    return (preamble + 4.25 + payload_symbols) * symbol;
+}
+
+/**
+ * Standard normal deviate from xorshift32 (Box-Muller), reproducible across platforms
+ */
+static float random_normal(unsigned int * state) {
+    double u[2];
+    for (int k = 0; k < 2; ++k) {
+        unsigned int x = *state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *state = x;
+        u[k] = ((x >> 8) + 0.5) / 16777216.0;
+    }
+    return (float) (sqrt(-2.0 * log(u[0])) * cos(6.283185307179586 * u[1]));
+}
+
+void lora_init(lora_radio_t * radio, int data_rate, bool adr, float snr_mean, float snr_sigma, unsigned int seed) {
+    radio->data_rate = data_rate;
+    radio->duty_cycle = EU868_DUTY_CYCLE;
+    radio->band_open_at = 0;
+    // SX1276 at 14 dBm and in receive, 3.3 V
+    radio->tx_mw = 145.0f;
+    radio->rx_mw = 36.0f;
+
+    radio->adr = adr;
+    radio->snr_mean = snr_mean;
+    radio->snr_sigma = snr_sigma;
+    radio->random = seed ? seed : 1;
+    radio->history_count = 0;
+    radio->adr_ack_counter = 0;
+
+    radio->frames = 0;
+    radio->lost = 0;
+    radio->blocked = 0;
+    for (int i = 0; i <= EU868_MAX_ADR_DR; ++i) {
+        radio->data_rate_frames[i] = 0;
+    }
+    radio->airtime = 0;
+    radio->energy_mj = 0;
+}
+
+/**
+ * Network server side of ADR, on every received frame: once ADR_HISTORY SNRs are known,
+ * raise the data rate by one step per 3 dB of margin (transmit power is left alone).
+ * Returns true when a LinkADRReq (a downlink) is sent back.
+ */
+static bool adr_server(lora_radio_t * radio, float snr, bool ack_requested) {
+    radio->snr_history[radio->history_count++] = snr;
+    if (radio->history_count < ADR_HISTORY) {
+        return ack_requested;
+    }
+    radio->history_count = 0;
+
+    float best = radio->snr_history[0];
+    for (int i = 1; i < ADR_HISTORY; ++i) {
+        best = fmaxf(best, radio->snr_history[i]);
+    }
+    float margin = best - eu868_data_rates[radio->data_rate].required_snr - ADR_MARGIN_DB;
+    int steps = (int) floorf(margin / 3.0f);
+    int data_rate = radio->data_rate;
+    while (steps > 0 && data_rate < EU868_MAX_ADR_DR) {
+        data_rate++;
+        steps--;
+    }
+    if (data_rate == radio->data_rate) {
+        return ack_requested;
+    }
+    radio->data_rate = data_rate;
+    return true;
+}
+
+int lora_send(lora_radio_t * radio, double now, int payload, double * done) {
+    if (now < radio->band_open_at) {
+        radio->blocked++;
+        *done = radio->band_open_at - now;
+        return -1;
+    }
+
+    const lora_data_rate_t & rate = eu868_data_rates[radio->data_rate];
+    const lora_data_rate_t & rx2 = eu868_data_rates[RX2_DATA_RATE];
+    double time_on_air = lora_time_on_air(rate.spreading_factor, rate.bandwidth_khz, payload + LORAWAN_OVERHEAD);
+    double rx1 = RX_WINDOW_SYMBOLS * (double) (1 << rate.spreading_factor) / (rate.bandwidth_khz * 1000.0);
+    double rx2_window = RX_WINDOW_SYMBOLS * (double) (1 << rx2.spreading_factor) / (rx2.bandwidth_khz * 1000.0);
+
+    radio->frames++;
+    radio->data_rate_frames[radio->data_rate]++;
+    radio->airtime += time_on_air;
+    radio->energy_mj += time_on_air * radio->tx_mw + (rx1 + rx2_window) * radio->rx_mw;
+    radio->band_open_at = now + time_on_air / radio->duty_cycle;
+    *done = now + time_on_air + RX2_DELAY + rx2_window;
+
+    if (!radio->adr) {
+        return 0;
+    }
+
+    // Uplink side of ADR: without downlinks the node requests one, then steps down
+    radio->adr_ack_counter++;
+    bool ack_requested = radio->adr_ack_counter >= ADR_ACK_LIMIT;
+    if (radio->adr_ack_counter >= ADR_ACK_LIMIT + ADR_ACK_DELAY
+        && (radio->adr_ack_counter - ADR_ACK_LIMIT) % ADR_ACK_DELAY == 0 && radio->data_rate > 0) {
+        radio->data_rate--;
+    }
+
+    float snr = radio->snr_mean + radio->snr_sigma * random_normal(&radio->random);
+    if (snr < rate.required_snr) {
+        radio->lost++;
+        return 0;
+    }
+    if (adr_server(radio, snr, ack_requested)) {
+        radio->adr_ack_counter = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+//
+// Host model of the node's LoRaWAN radio: EU868 time on air, band duty cycle and ADR.
+//
+// Follows what the Mbed stack does with lora.phy EU868 and lora.duty-cycle-on: after every
+// uplink its band is closed for 99 times the time on air, and send() returns WOULD_BLOCK
+// with the remaining backoff meanwhile.
+//
+
+#ifndef CPP_LORA_SIM_H
+#define CPP_LORA_SIM_H
+
+// MHDR, FHDR without FOpts, FPort and MIC around the application payload
+#define LORAWAN_OVERHEAD        13
+
+// EU868 default channels are all in the 1% sub-band
+#define EU868_DUTY_CYCLE        0.01
+
+// Data rates the ADR may pick for uplinks (DR6 and up are not used by network servers)
+#define EU868_MAX_ADR_DR        5
+
+// Frames whose SNR the server looks at before adjusting the data rate
+#define ADR_HISTORY             20
+
+// Uplinks without downlink before ADRACKReq is set, then before each data rate step down
+#define ADR_ACK_LIMIT           64
+#define ADR_ACK_DELAY           32
+
+struct lora_data_rate_t {
+    int spreading_factor;
+    int bandwidth_khz;
+    float required_snr;         // demodulation floor, dB
+};
+
+extern const lora_data_rate_t eu868_data_rates[];
+
+struct lora_radio_t {
+    int data_rate;
+    double duty_cycle;
+    double band_open_at;        // s, duty cycle backoff end
+    float tx_mw;                // power drawn while transmitting
+    float rx_mw;                // power drawn while a receive window is open
+
+    // Link and ADR
+    bool adr;
+    float snr_mean;             // dB at the gateway
+    float snr_sigma;            // per frame fading, dB
+    unsigned int random;
+    float snr_history[ADR_HISTORY];
+    int history_count;
+    int adr_ack_counter;        // uplinks since the last downlink
+
+    // Statistics
+    long frames;
+    long lost;                  // below the demodulation floor
+    long blocked;               // send() refused by the duty cycle
+    long data_rate_frames[EU868_MAX_ADR_DR + 1];
+    double airtime;             // s
+    double energy_mj;
+};
+
+/**
+ * Time on air in seconds of a LoRa frame with a PHY payload of phy_payload bytes,
+ * coding rate 4/5, 8 symbol preamble, explicit header and CRC (Semtech AN1200.13)
+ */
+double lora_time_on_air(int spreading_factor, int bandwidth_khz, int phy_payload);
+
+/**
+ * Radio at data_rate, ADR driven by a link of snr_mean +/- snr_sigma dB when adr is set
+ */
+void lora_init(lora_radio_t * radio, int data_rate, bool adr, float snr_mean, float snr_sigma, unsigned int seed);
+
+/**
+ * Uplink of payload application bytes at time now (s).
+ * Returns 0 and sets *done to the TX_DONE time (end of the second receive window), or -1
+ * (WOULD_BLOCK) and sets *done to the backoff left in seconds.
+ */
+int lora_send(lora_radio_t * radio, double now, int payload, double * done);
+
+#endif //CPP_LORA_SIM_H
@@ -0,0 +1,243 @@
+//
+// Memory plan of model configurations against the node targets.
+//
+// memplan [-a mbed_app.json] [model.h | hunit]...
+//
+// Prints flash, static RAM and main stack of the prediction application (memory_plan.h) for
+// each configuration, the compiled-in parameters.h by default, and checks them against the
+// main_stack_size, model-ram-budget and model-flash-budget of every target of mbed_app.json.
+// Exits with 2 when a configuration does not fit a target, the build runs it on parameters.h.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "conso_data.h"
+#include "dual_prediction.h"
+#include "memory_plan.h"
+#include "model.h"
+
+static_assert(sizeof(dual_prediction_t) == memory_plan_state_bytes(HUNIT),
+              "memory_plan.h is out of date with dual_prediction_t");
+
+struct target_budget_t {
+    std::string name;
+    long stack;
+    long ram;
+    long flash;
+};
+
+struct json_reader_t {
+    const char * cursor;
+    std::vector<std::string> path;
+    std::map<std::string, long> numbers;    // "a/b/c" -> value, for every number in the file
+    std::set<std::string> targets;          // keys of target_overrides
+};
+
+static void skip_space(json_reader_t * reader) {
+    while (*reader->cursor == ' ' || *reader->cursor == '\n' || *reader->cursor == '\r' || *reader->cursor == '\t') {
+        reader->cursor++;
+    }
+}
+
+static std::string read_string(json_reader_t * reader) {
+    std::string text;
+    reader->cursor++;
+    while (*reader->cursor && *reader->cursor != '"') {
+        if (*reader->cursor == '\\' && reader->cursor[1]) {
+            reader->cursor++;
+        }
+        text += *reader->cursor++;
+    }
+    if (*reader->cursor) {
+        reader->cursor++;
+    }
+    return text;
+}
+
+static std::string joined_path(const json_reader_t * reader) {
+    std::string text;
+    for (size_t i = 0; i < reader->path.size(); ++i) {
+        text += i ? "/" + reader->path[i] : reader->path[i];
+    }
+    return text;
+}
+
+/**
+ * Just enough JSON for mbed_app.json: objects, arrays, strings, integers and literals
+ * Returns 0, -1 on a syntax error
+ */
+static int read_value(json_reader_t * reader) {
+    skip_space(reader);
+    char c = *reader->cursor;
+    if (c == '{' || c == '[') {
+        char close = c == '{' ? '}' : ']';
+        reader->cursor++;
+        for (;;) {
+            skip_space(reader);
+            if (*reader->cursor == close) {
+                reader->cursor++;
+                return 0;
+            }
+            if (c == '{') {
+                if (*reader->cursor != '"') {
+                    return -1;
+                }
+                reader->path.push_back(read_string(reader));
+                if (reader->path.size() == 2 && reader->path[0] == "target_overrides" && reader->path[1] != "*") {
+                    reader->targets.insert(reader->path[1]);
+                }
+                skip_space(reader);
+                if (*reader->cursor++ != ':') {
+                    return -1;
+                }
+            } else {
+                reader->path.push_back("[]");
+            }
+            int status = read_value(reader);
+            reader->path.pop_back();
+            if (status < 0) {
+                return -1;
+            }
+            skip_space(reader);
+            if (*reader->cursor == ',') {
+                reader->cursor++;
+            } else if (*reader->cursor != close) {
+                return -1;
+            }
+        }
+    }
+    if (c == '"') {
+        read_string(reader);
+        return 0;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        char * end;
+        reader->numbers[joined_path(reader)] = strtol(reader->cursor, &end, 0);
+        reader->cursor = end;
+        return 0;
+    }
+    if (c >= 'a' && c <= 'z') {
+        while (*reader->cursor >= 'a' && *reader->cursor <= 'z') {
+            reader->cursor++;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Target override of key, else its config default, -1 if neither
+ */
+static long budget(const json_reader_t * reader, const std::string & target, const char * key) {
+    auto found = reader->numbers.find("target_overrides/" + target + "/" + key);
+    if (found == reader->numbers.end()) {
+        found = reader->numbers.find(std::string("config/") + key + "/value");
+    }
+    return found == reader->numbers.end() ? -1 : found->second;
+}
+
+static int load_targets(const char * path, std::vector<target_budget_t> * targets) {
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return -1;
+    }
+    std::string text;
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.append(chunk, read);
+    }
+    fclose(file);
+
+    json_reader_t reader;
+    reader.cursor = text.c_str();
+    if (read_value(&reader) < 0) {
+        fprintf(stderr, "%s: malformed JSON\n", path);
+        return -1;
+    }
+    for (const std::string & name : reader.targets) {
+        target_budget_t target = {name, budget(&reader, name, "main_stack_size"),
+                                  budget(&reader, name, "model-ram-budget"), budget(&reader, name, "model-flash-budget")};
+        if (target.stack < 0 || target.ram < 0 || target.flash < 0) {
+            fprintf(stderr, "%s: %s has no main_stack_size, model-ram-budget or model-flash-budget\n", path, name.c_str());
+            return -1;
+        }
+        targets->push_back(target);
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+    const char * app_path = "../MBED/mbed_app.json";
+    std::vector<const char *> configurations;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+            app_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: memplan [-a mbed_app.json] [model.h | hunit]...\n");
+            return 1;
+        } else {
+            configurations.push_back(argv[i]);
+        }
+    }
+
+    std::vector<target_budget_t> targets;
+    if (load_targets(app_path, &targets) < 0) {
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    std::vector<int> hunits;
+    if (configurations.empty()) {
+        names.push_back("parameters.h");
+        hunits.push_back(HUNIT);
+    }
+    for (const char * configuration : configurations) {
+        char * end;
+        long hunit = strtol(configuration, &end, 10);
+        if (*end == 0) {
+            names.push_back(std::string("hunit ") + configuration);
+            hunits.push_back((int) hunit);
+            continue;
+        }
+        lstm_model_t model;
+        if (model_load(&model, configuration) < 0) {
+            return 1;
+        }
+        names.push_back(configuration);
+        hunits.push_back(model.hunit);
+    }
+
+    int failures = 0;
+    printf("Model; Hunit; Flash; RAM; Stack; Does not fit\n");
+    for (size_t c = 0; c < names.size(); ++c) {
+        size_t hunit = hunits[c];
+        long flash = (long) memory_plan_flash_bytes(hunit, sizeof(conso_data));
+        long ram = (long) memory_plan_ram_bytes(hunit);
+        long stack = (long) memory_plan_stack_bytes(hunit);
+        printf("%s; %zu; %ld; %ld; %ld;", names[c].c_str(), hunit, flash, ram, stack);
+
+        int misfits = 0;
+        for (const target_budget_t & target : targets) {
+            std::string exceeded;
+            exceeded += flash > target.flash ? " flash" : "";
+            exceeded += ram > target.ram ? " RAM" : "";
+            exceeded += stack > target.stack ? " stack" : "";
+            if (!exceeded.empty()) {
+                printf(" %s (%s)", target.name.c_str(), exceeded.c_str() + 1);
+                misfits++;
+            }
+        }
+        printf(misfits ? "\n" : " -\n");
+        failures += misfits ? 1 : 0;
+    }
+    return failures ? 2 : 0;
+}
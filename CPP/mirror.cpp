@@ -0,0 +1,186 @@
+//
+// Server side half of dual prediction: rebuilds every device's full series from its uplinks.
+//
+
+#include <algorithm>
+
+#include "mirror.h"
+
+void mirror_init(mirror_t * mirror, mirror_emit_t emit, void * context) {
+    device_store_init(&mirror->store);
+    mirror->pending.clear();
+    mirror->emit = emit;
+    mirror->context = context;
+    mirror->duplicates = 0;
+    mirror->resyncs = 0;
+    mirror->model_mismatches = 0;
+    mirror->lost_frames = 0;
+}
+
+void mirror_free(mirror_t * mirror) {
+    device_store_free(&mirror->store);
+    mirror->pending.clear();
+}
+
+int mirror_device(mirror_t * mirror, const std::string & name) {
+    return device_store_add(&mirror->store, name);
+}
+
+int mirror_remove(mirror_t * mirror, const std::string & name) {
+    mirror_step(mirror);
+    return device_store_remove(&mirror->store, name);
+}
+
+void mirror_push(mirror_t * mirror, int device, const uplink_t * uplink) {
+    mirror_record_t record;
+    record.device = device;
+    record.uplink = *uplink;
+    mirror->pending.push_back(record);
+}
+
+/**
+ * Starts replaying the node's sample_tick() up to a record: restarts, duplicates and records
+ * after a lost frame are applied here.
+ * Returns true when the record is left to model steps, see mirror_step
+ */
+static bool mirror_begin(mirror_t * mirror, int slot, const uplink_t * uplink) {
+    device_store_t * store = &mirror->store;
+    device_cold_t * device = &store->cold[slot];
+    float value = payload_dequantize(uplink->value);
+
+    if (uplink->has_model_version && uplink->model_version != MODEL_VERSION) {
+        mirror->model_mismatches++;
+    }
+
+    // A node restarts its series at sequence 0 after a reboot
+    bool restart = uplink->sequence == 0 ||
+                   (uplink->has_model_version && uplink->sequence <= store->sequence[slot]);
+
+    if (!device->started || restart) {
+        if (uplink->sequence != 0 || device->started) {
+            mirror->resyncs++;
+        }
+        // Without the series from sequence 0, the node's model state cannot be rebuilt either
+        if (uplink->sequence != 0) {
+            mirror->lost_frames++;
+        }
+        device_store_restart(store, slot, value, uplink->sequence);
+        device->started = true;
+        device->diverged = uplink->sequence != 0;
+        device->corrections++;
+        if (mirror->emit) {
+            mirror->emit(mirror->context, slot, uplink->sequence, value, true);
+        }
+        return false;
+    }
+
+    if (uplink->sequence <= store->sequence[slot]) {
+        mirror->duplicates++;
+        return false;
+    }
+
+    // The node counts its skipped samples from the last correction it queued: any other gap is a
+    // lost frame, after which the node's model state can no longer be rebuilt
+    if (uplink->sequence - uplink->skipped - 1 != store->sequence[slot]) {
+        mirror->lost_frames++;
+        device->diverged = true;
+    }
+
+    // Only the transmitted values are known until the node restarts its series
+    if (device->diverged) {
+        device_store_restart(store, slot, value, uplink->sequence);
+        device->corrections++;
+        if (mirror->emit) {
+            mirror->emit(mirror->context, slot, uplink->sequence, value, true);
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Applies the model step of a record just predicted
+ * Returns true when it was the record's correction, false for a sample the node skipped
+ */
+static bool mirror_finish(mirror_t * mirror, int slot, const uplink_t * uplink, float forecast) {
+    device_store_t * store = &mirror->store;
+    device_cold_t * device = &store->cold[slot];
+
+    // Samples the node skipped: its forecast is the reconstructed value
+    if (store->sequence[slot] + 1 < uplink->sequence) {
+        device_store_commit(store, slot, forecast);
+        device->forecasts++;
+        if (mirror->emit) {
+            mirror->emit(mirror->context, slot, store->sequence[slot], forecast, false);
+        }
+        return false;
+    }
+
+    // The node still ran the model on the corrected sample, keep the LSTM state in step
+    float value = payload_dequantize(uplink->value);
+    device_store_correct(store, slot, value);
+    device->corrections++;
+    if (mirror->emit) {
+        mirror->emit(mirror->context, slot, uplink->sequence, value, true);
+    }
+    return true;
+}
+
+/**
+ * Moves a lane to its first record that needs a model step
+ * Returns false when none is left
+ */
+static bool lane_advance(mirror_t * mirror, mirror_lane_t * lane) {
+    for (; lane->next < lane->last; ++lane->next) {
+        if (mirror_begin(mirror, lane->device, &mirror->pending[lane->next].uplink)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Arrival order is kept within a device: a sequence going back to 0 is a reboot, not a reordering
+static bool record_order(const mirror_record_t & a, const mirror_record_t & b) {
+    return a.device < b.device;
+}
+
+void mirror_step(mirror_t * mirror) {
+    std::stable_sort(mirror->pending.begin(), mirror->pending.end(), record_order);
+
+    std::vector<mirror_lane_t> & lanes = mirror->lanes;
+    lanes.clear();
+    for (size_t first = 0; first < mirror->pending.size();) {
+        mirror_lane_t lane = {mirror->pending[first].device, first, first};
+        while (lane.last < mirror->pending.size() && mirror->pending[lane.last].device == lane.device) {
+            lane.last++;
+        }
+        first = lane.last;
+        if (lane_advance(mirror, &lane)) {
+            lanes.push_back(lane);
+        }
+    }
+
+    while (!lanes.empty()) {
+        mirror->slots.resize(lanes.size());
+        mirror->forecasts.resize(lanes.size());
+        for (size_t k = 0; k < lanes.size(); ++k) {
+            mirror->slots[k] = lanes[k].device;
+        }
+        device_store_predict(&mirror->store, mirror->slots.data(), (int) lanes.size(), mirror->forecasts.data());
+
+        // Lanes out of records leave the next wave
+        size_t kept = 0;
+        for (size_t k = 0; k < lanes.size(); ++k) {
+            mirror_lane_t lane = lanes[k];
+            if (mirror_finish(mirror, lane.device, &mirror->pending[lane.next].uplink, mirror->forecasts[k])) {
+                lane.next++;
+                if (!lane_advance(mirror, &lane)) {
+                    continue;
+                }
+            }
+            lanes[kept++] = lane;
+        }
+        lanes.resize(kept);
+    }
+    mirror->pending.clear();
+}
@@ -0,0 +1,85 @@
+//
+// Server side half of dual prediction: rebuilds every device's full series from its uplinks.
+//
+
+#ifndef CPP_MIRROR_H
+#define CPP_MIRROR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "device_store.h"
+#include "payload.h"
+
+// Longest device id the mirror takes, terminator included. Readers reject longer ids rather
+// than cut them, two ids sharing a prefix would share a state.
+#define MIRROR_NAME_BYTES       64
+
+/**
+ * Called for every reconstructed sample, in sequence order for a given device
+ */
+typedef void (*mirror_emit_t)(void * context, int device, uint32_t sequence, float value, bool transmitted);
+
+struct mirror_record_t {
+    int device;
+    uplink_t uplink;
+};
+
+// A device with records left in mirror_step, pending[next..last-1]
+struct mirror_lane_t {
+    int device;
+    size_t next;
+    size_t last;
+};
+
+struct mirror_t {
+    device_store_t store;                           // same states as the nodes hold, by slot
+    std::vector<mirror_record_t> pending;           // records waiting for mirror_step
+
+    // Scratch of mirror_step, kept to not reallocate every batch
+    std::vector<mirror_lane_t> lanes;
+    std::vector<int> slots;
+    std::vector<float> forecasts;
+
+    mirror_emit_t emit;
+    void * context;
+
+    uint64_t duplicates;        // records at or before the current sequence, ignored
+    uint64_t resyncs;           // series restarted (node reboot or first record not at 0)
+    uint64_t model_mismatches;  // uplinks announcing another MODEL_VERSION
+    uint64_t lost_frames;       // gaps in a device's corrections, see device_cold_t::diverged
+};
+
+/**
+ * emit - callback receiving reconstructed samples, may be null
+ * context - passed to emit
+ */
+void mirror_init(mirror_t * mirror, mirror_emit_t emit, void * context);
+
+void mirror_free(mirror_t * mirror);
+
+/**
+ * Returns the slot of a device, creating it on first use, -1 on allocation failure
+ */
+int mirror_device(mirror_t * mirror, const std::string & name);
+
+/**
+ * Applies what is queued and forgets a device, the device in the last slot takes its slot
+ * Returns 0, -1 if unknown
+ */
+int mirror_remove(mirror_t * mirror, const std::string & name);
+
+/**
+ * Queues a decoded record, nothing is computed until mirror_step
+ */
+void mirror_push(mirror_t * mirror, int device, const uplink_t * uplink);
+
+/**
+ * Applies every queued record. Records are grouped per device, in arrival order, then stepped
+ * in waves: each wave runs one model step of every device that still needs one as a single
+ * device_store_predict, a device moving to its next record once its correction is applied.
+ */
+void mirror_step(mirror_t * mirror);
+
+#endif //CPP_MIRROR_H
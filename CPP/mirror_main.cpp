@@ -0,0 +1,241 @@
+//
+// Dual prediction mirror: reconstructs meter series from uplinks.
+//
+// mirror [-q] [-s shards] [file]     reads uplink_decode CSV output from file or stdin
+// mirror [-q] [-s shards] -u port    listens for UDP datagrams "<device>\0<binary frame>", as a
+//                                    local stand-in for the network server forwarder
+//
+// Reconstructed samples are written as CSV: device,sequence,value,transmitted
+// With -s, devices are split over that many shard threads (0 for one per NUMA node), see
+// mirror_shards.h. Samples of a device keep their order, devices interleave.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "mirror.h"
+#include "mirror_shards.h"
+#include "uplink_batch.h"
+
+// Records applied per mirror_step when reading a file
+#define MIRROR_BATCH 4096
+
+static void print_sample(void * context, int device, uint32_t sequence, float value, bool transmitted) {
+    const mirror_t * mirror = (const mirror_t *) context;
+    printf("%s,%u,%.2f,%d\n", mirror->store.cold[device].name.c_str(), sequence, value, transmitted ? 1 : 0);
+}
+
+// Where the readers send records: the mirror itself, or the shards when there are
+struct sink_t {
+    mirror_t * mirror;
+    mirror_shards_t * shards;
+    bool unflushed;             // records not yet applied or handed to a shard
+    long long_ids;              // records rejected, their device id does not fit MIRROR_NAME_BYTES
+};
+
+static void sink_push(sink_t * sink, const char * device, size_t length, const uplink_t * uplink) {
+    // Same limit with or without shards, so that a device always gets the same state
+    if (length >= MIRROR_NAME_BYTES) {
+        sink->long_ids++;
+        return;
+    }
+    if (sink->shards) {
+        mirror_shards_push(sink->shards, device, length, uplink);
+    } else {
+        int slot = mirror_device(sink->mirror, std::string(device, length));
+        if (slot < 0) {
+            return;
+        }
+        mirror_push(sink->mirror, slot, uplink);
+        if (sink->mirror->pending.size() >= MIRROR_BATCH) {
+            mirror_step(sink->mirror);
+        }
+    }
+    sink->unflushed = true;
+}
+
+static void sink_flush(sink_t * sink) {
+    if (sink->shards) {
+        mirror_shards_flush(sink->shards);
+    } else {
+        mirror_step(sink->mirror);
+    }
+    sink->unflushed = false;
+}
+
+static int read_file(sink_t * sink, FILE * input) {
+    char line[256];
+    int errors = 0;
+
+    while (fgets(line, sizeof(line), input)) {
+        unsigned int sequence, skipped;
+        float value;
+        int model_version;
+
+        // The whole id is passed on, sink_push rejects the ones too long
+        const char * comma = strchr(line, ',');
+        if (!comma || sscanf(comma + 1, "%u,%u,%f,%d", &sequence, &skipped, &value, &model_version) != 4) {
+            // Header or malformed line
+            if (strncmp(line, "device,", 7) != 0) {
+                errors++;
+            }
+            continue;
+        }
+
+        uplink_t uplink;
+        uplink.sequence = sequence;
+        uplink.skipped = skipped;
+        uplink.value = payload_quantize(value);
+        uplink.has_model_version = model_version >= 0;
+        uplink.model_version = model_version >= 0 ? model_version : 0;
+        sink_push(sink, line, comma - line, &uplink);
+    }
+    sink_flush(sink);
+    return errors;
+}
+
+static int read_udp(sink_t * sink, int port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+
+    char datagram[64 + BATCH_MAX_SIZE];
+    uplink_t records[BATCH_MAX_SIZE / 2];
+    int errors = 0;
+
+    for (;;) {
+        // Block for the first datagram, then drain whatever arrived meanwhile as one batch
+        int flags = sink->unflushed ? MSG_DONTWAIT : 0;
+        ssize_t length = recv(fd, datagram, sizeof(datagram), flags);
+        if (length < 0) {
+            sink_flush(sink);
+            fflush(stdout);
+            continue;
+        }
+
+        const char * end = (const char *) memchr(datagram, 0, length);
+        if (!end) {
+            errors++;
+            continue;
+        }
+        int header = (int) (end - datagram) + 1;
+        int count = payload_decode_batch((const uint8_t *) datagram + header, (int) length - header,
+                                         records, sizeof(records) / sizeof(records[0]));
+        if (count < 0) {
+            errors++;
+            continue;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            sink_push(sink, datagram, end - datagram, &records[i]);
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char ** argv) {
+    bool quiet = false;
+    int port = 0;
+    int shard_count = -1;
+    const char * path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-q")) {
+            quiet = true;
+        } else if (!strcmp(argv[i], "-u") && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            shard_count = atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    static mirror_t mirror;
+    mirror_init(&mirror, quiet ? NULL : print_sample, &mirror);
+    static mirror_shards_t shards;
+    sink_t sink = {&mirror, NULL, false, 0};
+    if (shard_count >= 0) {
+        if (mirror_shards_start(&shards, shard_count, quiet ? NULL : print_sample) < 0) {
+            fprintf(stderr, "Cannot start the shards\n");
+            return 1;
+        }
+        sink.shards = &shards;
+        int pinned = 0;
+        for (int i = 0; i < shards.count; ++i) {
+            pinned += shards.shards[i].pinned;
+        }
+        fprintf(stderr, "%d shards over %zu NUMA nodes, %d pinned\n", shards.count, shards.nodes.size(), pinned);
+    }
+
+    if (!quiet) {
+        printf("device,sequence,value,transmitted\n");
+    }
+
+    int errors;
+    if (port) {
+        errors = read_udp(&sink, port);
+    } else {
+        FILE * input = stdin;
+        if (path && !(input = fopen(path, "r"))) {
+            fprintf(stderr, "Cannot open %s\n", path);
+            return 1;
+        }
+        errors = read_file(&sink, input);
+        if (input != stdin) {
+            fclose(input);
+        }
+    }
+
+    std::vector<const mirror_t *> mirrors(1, &mirror);
+    if (sink.shards) {
+        mirror_shards_stop(&shards);
+        mirrors.clear();
+        for (int i = 0; i < shards.count; ++i) {
+            mirrors.push_back(shards.shards[i].mirror);
+        }
+    }
+
+    uint64_t devices = 0, corrections = 0, forecasts = 0, duplicates = 0, resyncs = 0, mismatches = 0;
+    uint64_t lost = 0, diverged = 0;
+    for (const mirror_t * part : mirrors) {
+        devices += part->store.count;
+        for (const device_cold_t & device : part->store.cold) {
+            corrections += device.corrections;
+            forecasts += device.forecasts;
+            diverged += device.diverged;
+        }
+        duplicates += part->duplicates;
+        resyncs += part->resyncs;
+        mismatches += part->model_mismatches;
+        lost += part->lost_frames;
+    }
+    fprintf(stderr, "%llu devices, %llu transmitted, %llu forecast, %llu duplicates, %llu resyncs, "
+                    "%llu model mismatches, %llu lost frames, %llu devices diverged, %d malformed, %ld ids too long\n",
+            (unsigned long long) devices, (unsigned long long) corrections, (unsigned long long) forecasts,
+            (unsigned long long) duplicates, (unsigned long long) resyncs, (unsigned long long) mismatches,
+            (unsigned long long) lost, (unsigned long long) diverged, errors, sink.long_ids);
+    if (sink.shards) {
+        mirror_shards_destroy(&shards);
+    }
+    return errors < 0 ? 1 : 0;
+}
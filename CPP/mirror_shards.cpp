@@ -0,0 +1,211 @@
+//
+// Mirror split into device shards, each on its own thread kept on one NUMA node.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "conformance.h"
+#include "mirror_shards.h"
+
+/**
+ * Wakes the other side if it announced it sleeps on condition, see shard_run and
+ * mirror_shards_push. The fence orders the caller's publish or release before the flag is
+ * read, the sleeper orders its flag before it looks at the ring: one of them sees the other.
+ */
+static void wake(mirror_shard_t * shard, const std::atomic<bool> * waiting, std::condition_variable * condition) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting->load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        condition->notify_one();
+    }
+}
+
+/**
+ * Shard thread: places itself, allocates its state, then applies batches until stopped
+ */
+static void shard_run(mirror_shards_t * shards, mirror_shard_t * shard) {
+    const numa_node_t & node = shards->nodes[shard->node];
+    shard->pinned = numa_pin(&node) == 0;
+
+    // First touch from here, after pinning, so the pages land on the shard's node
+    shard->mirror = new mirror_t;
+    mirror_init(shard->mirror, shards->emit, shard->mirror);
+    shard->mirror->pending.reserve(MIRROR_SHARD_STEP + MIRROR_SHARD_BATCH);
+    void * memory = NULL;
+    if (posix_memalign(&memory, SPSC_RING_ALIGNMENT, sizeof(spsc_ring_t)) == 0) {
+        spsc_ring_t * ring = new (memory) spsc_ring_t;
+        if (spsc_ring_init(ring, MIRROR_SHARD_SLOTS, sizeof(mirror_routed_batch_t)) == 0) {
+            memset(ring->slots, 0, MIRROR_SHARD_SLOTS * ring->slot_bytes);
+            shard->ring = ring;
+        } else {
+            ring->~spsc_ring_t();
+            free(memory);
+        }
+    }
+    shard->ready.store(true, std::memory_order_release);
+    if (!shard->ring) {
+        return;
+    }
+
+    mirror_t * mirror = shard->mirror;
+    int idle = 0;
+    for (;;) {
+        mirror_routed_batch_t * batch = (mirror_routed_batch_t *) spsc_ring_peek(shard->ring);
+        if (batch) {
+            idle = 0;
+            for (int i = 0; i < batch->count; ++i) {
+                const mirror_routed_t & record = batch->records[i];
+                int slot = mirror_device(mirror, record.device);
+                if (slot >= 0) {
+                    mirror_push(mirror, slot, &record.uplink);
+                }
+            }
+            spsc_ring_release(shard->ring);
+            wake(shard, &shard->router_waiting, &shard->freed);
+            if (mirror->pending.size() >= MIRROR_SHARD_STEP) {
+                mirror_step(mirror);
+            }
+        } else if (!mirror->pending.empty()) {
+            mirror_step(mirror);
+        } else if (shard->stop.load(std::memory_order_acquire)) {
+            // Everything published before stop is visible now
+            if (!spsc_ring_peek(shard->ring)) {
+                break;
+            }
+        } else if (++idle < MIRROR_SHARD_SPINS) {
+            std::this_thread::yield();
+        } else {
+            // Idle, e.g. a UDP mirror without traffic: sleep until the router publishes or stops
+            std::unique_lock<std::mutex> guard(shard->lock);
+            shard->shard_waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!spsc_ring_peek(shard->ring) && !shard->stop.load(std::memory_order_acquire)) {
+                shard->filled.wait(guard);
+            }
+            shard->shard_waiting.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+}
+
+int mirror_shards_start(mirror_shards_t * shards, int count, mirror_emit_t emit) {
+    int node_count = numa_topology(&shards->nodes);
+    shards->count = count > 0 ? count : node_count;
+    shards->emit = emit;
+    shards->shards = new mirror_shard_t[shards->count];
+
+    for (int i = 0; i < shards->count; ++i) {
+        mirror_shard_t * shard = &shards->shards[i];
+        shard->node = i % node_count;
+        shard->pinned = false;
+        shard->mirror = NULL;
+        shard->ring = NULL;
+        shard->filling = NULL;
+        shard->ready.store(false);
+        shard->stop.store(false);
+        shard->shard_waiting.store(false);
+        shard->router_waiting.store(false);
+        shard->thread = std::thread(shard_run, shards, shard);
+    }
+
+    int status = 0;
+    for (int i = 0; i < shards->count; ++i) {
+        mirror_shard_t * shard = &shards->shards[i];
+        while (!shard->ready.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        if (!shard->ring) {
+            status = -1;
+        }
+    }
+    if (status < 0) {
+        mirror_shards_stop(shards);
+        mirror_shards_destroy(shards);
+    }
+    return status;
+}
+
+int mirror_shards_push(mirror_shards_t * shards, const char * device, size_t length, const uplink_t * uplink) {
+    if (length >= MIRROR_NAME_BYTES) {
+        return -1;
+    }
+    // FNV-1a of the id, the owning shard never changes
+    uint32_t hash = conformance_hash_bytes(CONFORMANCE_HASH_SEED, (const uint8_t *) device, (int) length);
+    mirror_shard_t * shard = &shards->shards[hash % shards->count];
+
+    for (int spins = 0; !shard->filling; ++spins) {
+        shard->filling = (mirror_routed_batch_t *) spsc_ring_acquire(shard->ring);
+        if (shard->filling) {
+            shard->filling->count = 0;
+        } else if (spins < MIRROR_SHARD_SPINS) {
+            // The shard is behind, backpressure on the reader
+            std::this_thread::yield();
+        } else {
+            std::unique_lock<std::mutex> guard(shard->lock);
+            shard->router_waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!(shard->filling = (mirror_routed_batch_t *) spsc_ring_acquire(shard->ring))) {
+                shard->freed.wait(guard);
+            }
+            shard->router_waiting.store(false, std::memory_order_relaxed);
+            shard->filling->count = 0;
+        }
+    }
+
+    mirror_routed_t * record = &shard->filling->records[shard->filling->count++];
+    memcpy(record->device, device, length);
+    record->device[length] = 0;
+    record->uplink = *uplink;
+    if (shard->filling->count == MIRROR_SHARD_BATCH) {
+        spsc_ring_publish(shard->ring);
+        shard->filling = NULL;
+        wake(shard, &shard->shard_waiting, &shard->filled);
+    }
+    return 0;
+}
+
+void mirror_shards_flush(mirror_shards_t * shards) {
+    for (int i = 0; i < shards->count; ++i) {
+        mirror_shard_t * shard = &shards->shards[i];
+        if (shard->filling) {
+            spsc_ring_publish(shard->ring);
+            shard->filling = NULL;
+            wake(shard, &shard->shard_waiting, &shard->filled);
+        }
+    }
+}
+
+void mirror_shards_stop(mirror_shards_t * shards) {
+    mirror_shards_flush(shards);
+    for (int i = 0; i < shards->count; ++i) {
+        mirror_shard_t * shard = &shards->shards[i];
+        shard->stop.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> guard(shard->lock);
+        shard->filled.notify_one();
+    }
+    for (int i = 0; i < shards->count; ++i) {
+        if (shards->shards[i].thread.joinable()) {
+            shards->shards[i].thread.join();
+        }
+    }
+}
+
+void mirror_shards_destroy(mirror_shards_t * shards) {
+    for (int i = 0; i < shards->count; ++i) {
+        mirror_shard_t * shard = &shards->shards[i];
+        if (shard->ring) {
+            spsc_ring_destroy(shard->ring);
+            shard->ring->~spsc_ring_t();
+            free(shard->ring);
+        }
+        if (shard->mirror) {
+            mirror_free(shard->mirror);
+            delete shard->mirror;
+        }
+    }
+    delete[] shards->shards;
+    shards->shards = NULL;
+    shards->count = 0;
+}
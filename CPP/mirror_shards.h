@@ -0,0 +1,101 @@
+//
+// Mirror split into device shards, each on its own thread kept on one NUMA node.
+//
+// Devices are spread over the shards by a hash of their id. Each shard thread pins itself to
+// its node before it allocates anything, so its mirror (device index, dual prediction states)
+// and the ring it is fed through are first touched, hence placed, on that node and never
+// shared. The router (the thread reading uplinks) only copies records into the owning
+// shard's ring (spsc_ring.h), waiting when the shard is behind.
+//
+// Neither side spins while idle: a shard with nothing to do, or the router facing a full
+// ring, yields MIRROR_SHARD_SPINS times, then sleeps until the other side publishes or
+// releases a slot.
+//
+
+#ifndef CPP_MIRROR_SHARDS_H
+#define CPP_MIRROR_SHARDS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mirror.h"
+#include "numa.h"
+#include "spsc_ring.h"
+
+// Records per ring slot, and slots per ring
+#define MIRROR_SHARD_BATCH      64
+#define MIRROR_SHARD_SLOTS      64
+
+// Records a shard queues before it runs mirror_step, it also steps whenever its ring is empty
+#define MIRROR_SHARD_STEP       4096
+
+// Polls of an empty (shard) or full (router) ring before sleeping
+#define MIRROR_SHARD_SPINS      64
+
+struct mirror_routed_t {
+    char device[MIRROR_NAME_BYTES];
+    uplink_t uplink;
+};
+
+struct mirror_routed_batch_t {
+    int count;
+    mirror_routed_t records[MIRROR_SHARD_BATCH];
+};
+
+struct mirror_shard_t {
+    int node;                           // NUMA node id
+    bool pinned;
+    mirror_t * mirror;                  // allocated by the shard thread
+    spsc_ring_t * ring;                 // allocated by the shard thread
+    mirror_routed_batch_t * filling;    // router side, slot being filled or NULL
+    std::thread thread;
+    std::atomic<bool> ready;
+    std::atomic<bool> stop;
+
+    // Sleeping sides, each announced by its flag before it waits
+    std::mutex lock;
+    std::condition_variable filled;     // the shard waits for a published slot or stop
+    std::condition_variable freed;      // the router waits for a free slot
+    std::atomic<bool> shard_waiting;
+    std::atomic<bool> router_waiting;
+};
+
+struct mirror_shards_t {
+    std::vector<numa_node_t> nodes;
+    mirror_shard_t * shards;
+    int count;
+    mirror_emit_t emit;
+};
+
+/**
+ * Starts the shard threads and waits until they are placed
+ * count - number of shards, 0 for one per NUMA node; shards are dealt over the nodes in turn
+ * emit - called by the shard threads, each with its own mirror_t as context
+ * Returns 0, -1 if a shard cannot allocate its ring, everything being released then
+ */
+int mirror_shards_start(mirror_shards_t * shards, int count, mirror_emit_t emit);
+
+/**
+ * Router: queues a record for the shard owning device
+ * Returns 0, -1 if the id does not fit MIRROR_NAME_BYTES
+ */
+int mirror_shards_push(mirror_shards_t * shards, const char * device, size_t length, const uplink_t * uplink);
+
+/**
+ * Router: hands partially filled slots over, to be called when no more input is ready
+ */
+void mirror_shards_flush(mirror_shards_t * shards);
+
+/**
+ * Flushes, lets every shard apply what it was sent and joins the threads. The shard
+ * mirrors stay readable until mirror_shards_destroy.
+ */
+void mirror_shards_stop(mirror_shards_t * shards);
+
+void mirror_shards_destroy(mirror_shards_t * shards);
+
+#endif //CPP_MIRROR_SHARDS_H
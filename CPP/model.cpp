@@ -0,0 +1,340 @@
+//
+// Runtime view of a model file (the parameters.h format generated by the notebooks).
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "deterministic.h"
+#include "handmade.h"
+#include "model.h"
+#include "node_config.h"
+#include "node_sample.h"
+#include "parameters.h"
+
+void model_from_parameters(lstm_model_t * model) {
+    model->hunit = HUNIT;
+    model->version = MODEL_VERSION;
+#ifdef MODEL_SCALER_FOLDED
+    model->scaler_folded = true;
+#else
+    model->scaler_folded = false;
+#endif
+    model->input_weights.assign(lstm_cell_input_weights, lstm_cell_input_weights + 4 * HUNIT);
+    model->hidden_weights.assign(lstm_cell_hidden_weights, lstm_cell_hidden_weights + 4 * HUNIT * HUNIT);
+    model->bias.assign(lstm_cell_bias, lstm_cell_bias + 4 * HUNIT);
+    model->hidden_layer.assign(lstm_cell_hidden_layer, lstm_cell_hidden_layer + HUNIT);
+    model->cell_states.assign(lstm_cell_cell_states, lstm_cell_cell_states + HUNIT);
+    model->dense_weights.assign(dense_weights, dense_weights + HUNIT);
+    model->dense_bias = dense_bias;
+    model->scaler = model_scaler();
+}
+
+/**
+ * Reads the integer of "#define name value"
+ */
+static int parse_define(const std::string & text, const char * name, int * value) {
+    std::string pattern = std::string("#define ") + name + " ";
+    size_t position = text.find(pattern);
+    if (position == std::string::npos) {
+        return -1;
+    }
+    *value = atoi(text.c_str() + position + pattern.size());
+    return 0;
+}
+
+/**
+ * Reads the values of "name[...] = {...};" or "name = value;". Literals are converted like the
+ * compiler does for a float initialiser: parsed as double, then rounded to float.
+ */
+static int parse_values(const std::string & text, const char * name, std::vector<float> * values, size_t expected) {
+    size_t position = 0;
+    size_t length = strlen(name);
+
+    // Whole identifier followed by '[' or ' ='
+    for (;;) {
+        position = text.find(name, position);
+        if (position == std::string::npos) {
+            return -1;
+        }
+        char before = position ? text[position - 1] : ' ';
+        char after = text[position + length];
+        if ((before == ' ' || before == '\n') && (after == '[' || after == ' ')) {
+            break;
+        }
+        position += length;
+    }
+
+    size_t equal = text.find('=', position);
+    size_t end = text.find(';', position);
+    if (equal == std::string::npos || end == std::string::npos || equal > end) {
+        return -1;
+    }
+
+    values->clear();
+    const char * cursor = text.c_str() + equal + 1;
+    const char * last = text.c_str() + end;
+    while (cursor < last) {
+        if (*cursor == '{' || *cursor == '}' || *cursor == ',' || *cursor == ' ' || *cursor == '\n') {
+            cursor++;
+            continue;
+        }
+        char * next;
+        double value = strtod(cursor, &next);
+        if (next == cursor) {
+            return -1;
+        }
+        values->push_back((float) value);
+        cursor = next;
+    }
+    return values->size() == expected ? 0 : -1;
+}
+
+int model_load(lstm_model_t * model, const char * path) {
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open model %s\n", path);
+        return -1;
+    }
+    std::string text;
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.append(chunk, read);
+    }
+    fclose(file);
+
+    int hunit;
+    if (parse_define(text, "HUNIT", &hunit) < 0 || hunit < 1 || hunit > MODEL_MAX_HUNIT) {
+        fprintf(stderr, "%s: missing or unsupported HUNIT\n", path);
+        return -1;
+    }
+    model->hunit = hunit;
+    if (parse_define(text, "MODEL_VERSION", &model->version) < 0) {
+        model->version = 0;
+    }
+    model->scaler_folded = text.find("#define MODEL_SCALER_FOLDED") != std::string::npos;
+
+    std::vector<float> scalar;
+    if (parse_values(text, "lstm_cell_input_weights", &model->input_weights, 4 * hunit) < 0 ||
+        parse_values(text, "lstm_cell_hidden_weights", &model->hidden_weights, 4 * hunit * hunit) < 0 ||
+        parse_values(text, "lstm_cell_bias", &model->bias, 4 * hunit) < 0 ||
+        parse_values(text, "lstm_cell_hidden_layer", &model->hidden_layer, hunit) < 0 ||
+        parse_values(text, "lstm_cell_cell_states", &model->cell_states, hunit) < 0 ||
+        parse_values(text, "dense_weights", &model->dense_weights, hunit) < 0 ||
+        parse_values(text, "dense_bias", &scalar, 1) < 0) {
+        fprintf(stderr, "%s: malformed model\n", path);
+        return -1;
+    }
+    model->dense_bias = scalar[0];
+
+    // Older exports carry no scaler, they were all trained with the same one
+    scaler_t scaler = model_scaler();
+    if (parse_values(text, "scaler_x_min", &scalar, 1) == 0) { scaler.x_min = scalar[0]; }
+    if (parse_values(text, "scaler_x_max", &scalar, 1) == 0) { scaler.x_max = scalar[0]; }
+    if (parse_values(text, "scaler_tx_min", &scalar, 1) == 0) { scaler.tx_min = scalar[0]; }
+    if (parse_values(text, "scaler_tx_max", &scalar, 1) == 0) { scaler.tx_max = scalar[0]; }
+    model->scaler = scaler;
+    return 0;
+}
+
+static void write_array(FILE * file, const char * declaration, const std::vector<float> & values) {
+    fprintf(file, "%s = {", declaration);
+    for (size_t i = 0; i < values.size(); ++i) {
+        fprintf(file, i ? ", %.9g" : "%.9g", values[i]);
+    }
+    fprintf(file, "};\n");
+}
+
+int model_save(const lstm_model_t * model, const char * path) {
+    FILE * file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write model %s\n", path);
+        return -1;
+    }
+
+    fprintf(file, "//\n// Generated by the CPP model tools.\n//\n\n");
+    fprintf(file, "#ifndef CPP_PARAMETERS_H\n#define CPP_PARAMETERS_H\n\n");
+    fprintf(file, "#define HUNIT %d\n\n", model->hunit);
+    fprintf(file, "// Identifies this set of weights in uplinks, bump on every export\n");
+    fprintf(file, "#define MODEL_VERSION %d\n\n", model->version);
+    if (model->scaler_folded) {
+        fprintf(file, "// Input scaling and output unscaling are folded into the weights\n");
+        fprintf(file, "#define MODEL_SCALER_FOLDED\n\n");
+    }
+    fprintf(file, "const int hunit = HUNIT;\n\n");
+    write_array(file, "const float lstm_cell_input_weights[4 * HUNIT]", model->input_weights);
+    fprintf(file, "\n");
+    write_array(file, "const float lstm_cell_hidden_weights[4 * HUNIT * HUNIT]", model->hidden_weights);
+    fprintf(file, "\n");
+    write_array(file, "const float lstm_cell_bias[4 * HUNIT]", model->bias);
+    fprintf(file, "\n// Initial states, copied into each dual prediction state\n");
+    write_array(file, "const float lstm_cell_hidden_layer[HUNIT]", model->hidden_layer);
+    write_array(file, "const float lstm_cell_cell_states[HUNIT]", model->cell_states);
+    fprintf(file, "\n");
+    write_array(file, "const float dense_weights[HUNIT]", model->dense_weights);
+    fprintf(file, "const float dense_bias = %.9g;\n\n", model->dense_bias);
+    fprintf(file, "// Scaler fitted on the differenced training set, MinMaxScaler(feature_range=(0, 0.9))\n");
+    fprintf(file, "const float scaler_x_min = %.9g;\n", model->scaler.x_min);
+    fprintf(file, "const float scaler_x_max = %.9g;\n", model->scaler.x_max);
+    fprintf(file, "const float scaler_tx_min = %.9g;\n", model->scaler.tx_min);
+    fprintf(file, "const float scaler_tx_max = %.9g;\n", model->scaler.tx_max);
+    fprintf(file, "\n#endif //CPP_PARAMETERS_H\n");
+
+    int status = ferror(file) ? -1 : 0;
+    fclose(file);
+    return status;
+}
+
+void model_fold_scaler(lstm_model_t * model) {
+    if (model->scaler_folded) {
+        return;
+    }
+    const scaler_t & scaler = model->scaler;
+    const int hunit = model->hunit;
+
+    double a = ((double) scaler.tx_max - scaler.tx_min) / ((double) scaler.x_max - scaler.x_min);
+    double b = scaler.tx_min - scaler.x_min * a;
+    for (int k = 0; k < 4 * hunit; ++k) {
+        double weight = model->input_weights[k];
+        model->bias[k] = (float) (model->bias[k] + b * weight);
+        model->input_weights[k] = (float) (a * weight);
+    }
+
+    double c = ((double) scaler.x_max - scaler.x_min) / ((double) scaler.tx_max - scaler.tx_min);
+    double e = scaler.x_min - scaler.tx_min * c;
+    for (int i = 0; i < hunit; ++i) {
+        model->dense_weights[i] = (float) (c * model->dense_weights[i]);
+    }
+    model->dense_bias = (float) (c * model->dense_bias + e);
+
+    model->scaler_folded = true;
+}
+
+void model_step(const lstm_model_t * model, float input, float * hidden_layer, float * cell_states) {
+    const int hunit = model->hunit;
+    const float * input_weights = model->input_weights.data();
+    const float * hidden_weights = model->hidden_weights.data();
+    const float * bias = model->bias.data();
+
+    float input_gate[MODEL_MAX_HUNIT];
+    float forget_gate[MODEL_MAX_HUNIT];
+    float cell_candidate[MODEL_MAX_HUNIT];
+    float output_gate[MODEL_MAX_HUNIT];
+
+    for (int i = 0; i < hunit; ++i) {
+        input_gate[i] = input_weights[0 * hunit + i] * input;
+        forget_gate[i] = input_weights[1 * hunit + i] * input;
+        cell_candidate[i] = input_weights[2 * hunit + i] * input;
+        output_gate[i] = input_weights[3 * hunit + i] * input;
+
+        for (int j = 0; j < hunit; ++j) {
+            input_gate[i] += hidden_weights[(0 * hunit + i) * hunit + j] * hidden_layer[j];
+            forget_gate[i] += hidden_weights[(1 * hunit + i) * hunit + j] * hidden_layer[j];
+            cell_candidate[i] += hidden_weights[(2 * hunit + i) * hunit + j] * hidden_layer[j];
+            output_gate[i] += hidden_weights[(3 * hunit + i) * hunit + j] * hidden_layer[j];
+        }
+
+        input_gate[i] += bias[0 * hunit + i];
+        forget_gate[i] += bias[1 * hunit + i];
+        cell_candidate[i] += bias[2 * hunit + i];
+        output_gate[i] += bias[3 * hunit + i];
+
+        input_gate[i] = sigmoid_function(input_gate[i]);
+        forget_gate[i] = sigmoid_function(forget_gate[i]);
+        cell_candidate[i] = sigmoid_function(cell_candidate[i]);
+        output_gate[i] = sigmoid_function(output_gate[i]);
+    }
+
+    // Every new state only depends on its own gates, h and c can be updated in place
+    for (int i = 0; i < hunit; ++i) {
+        cell_states[i] = forget_gate[i] * cell_states[i] + input_gate[i] * cell_candidate[i];
+        hidden_layer[i] = output_gate[i] * tanh_function(cell_states[i]);
+    }
+}
+
+float model_dense(const lstm_model_t * model, const float * hidden_layer) {
+    float output = 0;
+    for (int i = 0; i < model->hunit; ++i) {
+        output += hidden_layer[i] * model->dense_weights[i];
+    }
+    output += model->dense_bias;
+    return output;
+}
+
+void model_forecast_series(const lstm_model_t * model, const float * series, float * forecast, int length) {
+    float hidden_layer[MODEL_MAX_HUNIT];
+    float cell_states[MODEL_MAX_HUNIT];
+    memcpy(hidden_layer, model->hidden_layer.data(), model->hunit * sizeof(float));
+    memcpy(cell_states, model->cell_states.data(), model->hunit * sizeof(float));
+
+    if (length > 0) {
+        forecast[0] = series[0];
+    }
+    for (int i = 1; i < length; ++i) {
+        float diff = i > 1 ? series[i - 1] - series[i - 2] : 0;
+        float input = model->scaler_folded ? diff : scale_value(&model->scaler, diff);
+
+        model_step(model, input, hidden_layer, cell_states);
+        float output = model_dense(model, hidden_layer);
+
+        float y_diff = model->scaler_folded ? output : invert_scale_value(&model->scaler, output);
+        forecast[i] = y_diff + series[i - 1];
+    }
+}
+
+float model_mape(const lstm_model_t * model, const float * series, int length, int start) {
+    std::vector<float> forecast(length);
+    model_forecast_series(model, series, forecast.data(), length);
+
+    double total = 0;
+    int count = 0;
+    for (int i = start > 1 ? start : 1; i < length; ++i) {
+        if (series[i] != 0) {
+            total += fabs(((double) forecast[i] - series[i]) / series[i]);
+            count++;
+        }
+    }
+    return count ? (float) (100 * total / count) : 0;
+}
+
+int model_replay(const lstm_model_t * model, const float * series, int length, int start, float threshold,
+                 unsigned char * sent, const node_uplink_t * uplink) {
+    float hidden_layer[MODEL_MAX_HUNIT];
+    float cell_states[MODEL_MAX_HUNIT];
+    memcpy(hidden_layer, model->hidden_layer.data(), model->hunit * sizeof(float));
+    memcpy(cell_states, model->cell_states.data(), model->hunit * sizeof(float));
+
+    float previous = 0;
+    float previous_diff = 0;
+    int transmitted = 0;
+    for (int i = 0; i < length; ++i) {
+        float forecast = 0;
+        if (i > 0) {
+            float input = model->scaler_folded ? previous_diff : scale_value(&model->scaler, previous_diff);
+            model_step(model, input, hidden_layer, cell_states);
+            float output = model_dense(model, hidden_layer);
+            float y_diff = model->scaler_folded ? output : invert_scale_value(&model->scaler, output);
+            forecast = previous + y_diff;
+        }
+
+        node_sample_t sample;
+        node_sample_decide(&sample, i == 0, series[i], forecast, threshold);
+        if (uplink) {
+            node_sample_send(uplink, (uint32_t) i, &sample);
+            if (batch_due(uplink->batch, (uint32_t) i + 1, BATCH_MAX_LATENCY, uplink->max_payload)) {
+                uplink->flush(uplink->context);
+            }
+        }
+        transmitted += sample.transmitted && i >= start;
+        if (sent) {
+            sent[i] = sample.transmitted ? 1 : 0;
+        }
+        previous_diff = i > 0 ? sample.value - previous : 0;
+        previous = sample.value;
+    }
+    return transmitted;
+}
@@ -0,0 +1,95 @@
+//
+// Runtime view of a model file (the parameters.h format generated by the notebooks).
+//
+// The node compiles parameters.h in, host tools load any number of model files at runtime
+// and run them with the same arithmetic as lstmCellSimple/dense_nn.
+//
+
+#ifndef CPP_MODEL_H
+#define CPP_MODEL_H
+
+#include <vector>
+
+#include "preprocess.h"
+
+// Largest hidden layer model_step accepts
+#define MODEL_MAX_HUNIT 64
+
+struct node_uplink_t;
+
+struct lstm_model_t {
+    int hunit;
+    int version;
+    bool scaler_folded;                 // scaling is part of the weights (MODEL_SCALER_FOLDED)
+    std::vector<float> input_weights;   // 4*hunit - W_i, W_f, W_c, W_o
+    std::vector<float> hidden_weights;  // 4*hunit*hunit - U_i, U_f, U_c, U_o
+    std::vector<float> bias;            // 4*hunit - B_i, B_f, B_c, B_o
+    std::vector<float> hidden_layer;    // hunit - initial h
+    std::vector<float> cell_states;     // hunit - initial c
+    std::vector<float> dense_weights;   // hunit
+    float dense_bias;
+    scaler_t scaler;
+};
+
+/**
+ * Copies the model compiled in from ../MBED/parameters.h
+ */
+void model_from_parameters(lstm_model_t * model);
+
+/**
+ * Parses a parameters.h file
+ * Returns 0, -1 if the file cannot be read or misses a field
+ */
+int model_load(lstm_model_t * model, const char * path);
+
+/**
+ * Writes a parameters.h file the firmware can include as is
+ * Returns 0, -1 on I/O error
+ */
+int model_save(const lstm_model_t * model, const char * path);
+
+/**
+ * Folds input scaling into the input weights and bias, and output unscaling into the dense
+ * head, so the model takes raw differences and returns raw deltas:
+ *   x_scaled = a*x + b          ->  W' = a*W,  B' = B + b*W
+ *   y = c*(w.h + d) + e         ->  w' = c*w,  d' = c*d + e
+ * Folding is done in double, results differ from the unfused path by float rounding only.
+ */
+void model_fold_scaler(lstm_model_t * model);
+
+/**
+ * One LSTM step, same evaluation order as lstmCellSimple
+ */
+void model_step(const lstm_model_t * model, float input, float * hidden_layer, float * cell_states);
+
+/**
+ * Dense head, same evaluation order as dense_nn
+ */
+float model_dense(const lstm_model_t * model, const float * hidden_layer);
+
+/**
+ * One step forecasts of a series with the true previous values as input (teacher forcing).
+ * forecast[i] is the prediction of series[i] made from series[0..i-1], forecast[0] = series[0].
+ */
+void model_forecast_series(const lstm_model_t * model, const float * series, float * forecast, int length);
+
+/**
+ * Mean absolute percentage error of the one step forecasts of series[start..length-1],
+ * the state being built up over series[0..start-1] first (mean_absolute_percentage_error in
+ * the notebooks). Zero readings are left out.
+ */
+float model_mape(const lstm_model_t * model, const float * series, int length, int start);
+
+/**
+ * Dual prediction replay with a fixed threshold, as sample_tick runs it: the model is fed
+ * the reconstructed series, not the readings.
+ * sent - optional, sent[i] is set to 1 when sample i is transmitted, 0 otherwise
+ * uplink - optional, corrections are queued through node_sample_send with sequence i, and the
+ *   batch is flushed once due after each sample (BATCH_MAX_LATENCY), as sample_tick does.
+ *   A dropped correction is reconstructed from its forecast.
+ * Returns the number of samples of series[start..length-1] transmitted.
+ */
+int model_replay(const lstm_model_t * model, const float * series, int length, int start, float threshold,
+                 unsigned char * sent, const node_uplink_t * uplink);
+
+#endif //CPP_MODEL_H
@@ -0,0 +1,186 @@
+//
+// Per meter model selection over a dataset export.
+//
+// model_select [-d dataset.csv] [-t threshold] [-k skip target] [-b buckets] [-n minimum samples]
+//              [-o selection.csv] [-c] [model.h...]
+//
+// Replays every model on every meter in one pass (ensemble.h), then gives each meter the
+// smallest model, by flash (memory_plan.h), whose skip rate reaches the target, and with -b
+// the smallest per time-of-day bucket as well. -o exports the selection as CSV, one row per
+// meter and bucket ("-" for the whole series). -c checks every replay against model_replay.
+// Models default to ../Python/parameters.1.h to parameters.11.h.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "ensemble.h"
+#include "memory_plan.h"
+#include "model.h"
+
+static void write_row(FILE * file, const meter_series_t & meter, const char * bucket, const char * name,
+                      const lstm_model_t & model, size_t bytes, float skip_rate, bool met) {
+    fprintf(file, "%lld; %d; %s; %s; %d; %zu; %.4f; %s\n", meter.square, meter.country, bucket, name, model.hunit,
+            bytes, skip_rate, met ? "yes" : "no");
+}
+
+int main(int argc, char ** argv) {
+    const char * path = "../Python/dataset.csv";
+    const char * output = NULL;
+    float threshold = 0.3f;
+    float target = 0.5f;
+    int buckets = 1;
+    size_t minimum = 0;
+    bool check = false;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "-c")) {
+            check = true;
+        } else if (!strcmp(argv[i], "-d") && has_value) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && has_value) {
+            threshold = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-k") && has_value) {
+            target = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-b") && has_value) {
+            buckets = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && has_value) {
+            minimum = (size_t) atol(argv[++i]);
+        } else if (!strcmp(argv[i], "-o") && has_value) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: model_select [-d dataset.csv] [-t threshold] [-k skip target] [-b buckets]"
+                            " [-n minimum samples] [-o selection.csv] [-c] [model.h...]\n");
+            return 1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (buckets < 1 || buckets > ENSEMBLE_MAX_BUCKETS) {
+        fprintf(stderr, "Buckets must be between 1 and %d\n", ENSEMBLE_MAX_BUCKETS);
+        return 1;
+    }
+    if (paths.empty()) {
+        for (int n = 1; n <= 11; ++n) {
+            paths.push_back("../Python/parameters." + std::to_string(n) + ".h");
+        }
+    }
+
+    std::vector<lstm_model_t> models(paths.size());
+    std::vector<size_t> model_bytes(paths.size());
+    for (size_t m = 0; m < paths.size(); ++m) {
+        if (model_load(&models[m], paths[m].c_str()) < 0) {
+            return 1;
+        }
+        model_bytes[m] = memory_plan_model_flash_bytes(models[m].hunit);
+    }
+    const int model_count = (int) models.size();
+
+    std::vector<meter_series_t> all_meters;
+    if (dataset_load(path, DATASET_VALUE_COLUMN, &all_meters) < 0) {
+        return 1;
+    }
+    std::vector<meter_series_t> meters;
+    for (const meter_series_t & meter : all_meters) {
+        if (meter.values.size() >= minimum && !meter.values.empty()) {
+            meters.push_back(meter);
+        }
+    }
+    if (meters.empty()) {
+        fprintf(stderr, "No meter with %zu samples\n", minimum);
+        return 1;
+    }
+
+    std::vector<ensemble_score_t> scores(meters.size() * model_count);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (ensemble_evaluate(models.data(), model_count, meters, threshold, buckets, scores.data()) < 0) {
+        fprintf(stderr, "Cannot run the models\n");
+        return 1;
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    int mismatches = 0;
+    if (check) {
+        for (size_t i = 0; i < meters.size(); ++i) {
+            const meter_series_t & meter = meters[i];
+            for (int m = 0; m < model_count; ++m) {
+                int transmitted = model_replay(&models[m], meter.values.data(), (int) meter.values.size(), 0,
+                                               threshold, NULL, NULL);
+                mismatches += transmitted != scores[i * model_count + m].transmitted;
+            }
+        }
+    }
+
+    // Fleet view of each model alone
+    long samples = 0;
+    for (const meter_series_t & meter : meters) {
+        samples += meter.values.size();
+    }
+    printf("%zu meters, %ld samples, %d models, %.1f ms\n", meters.size(), samples, model_count, elapsed_ms);
+    printf("Model; Hunit; Flash; Skip rate; Meters on target\n");
+    for (int m = 0; m < model_count; ++m) {
+        long transmitted = 0;
+        int on_target = 0;
+        for (size_t i = 0; i < meters.size(); ++i) {
+            const ensemble_score_t & score = scores[i * model_count + m];
+            transmitted += score.transmitted;
+            on_target += ensemble_skip_rate(&score, -1) >= target;
+        }
+        printf("%s; %d; %zu; %.4f; %d\n", paths[m].c_str(), models[m].hunit, model_bytes[m],
+               1.0 - (double) transmitted / samples, on_target);
+    }
+
+    FILE * file = stdout;
+    if (output && !(file = fopen(output, "w"))) {
+        fprintf(stderr, "Cannot write %s\n", output);
+        return 1;
+    }
+    if (output) {
+        fprintf(file, "Square; Country; Bucket; Model; Hunit; Flash; Skip rate; On target\n");
+    }
+
+    // Selection
+    std::vector<int> chosen(model_count, 0);
+    size_t fleet_bytes = 0;
+    int met_count = 0;
+    for (size_t i = 0; i < meters.size(); ++i) {
+        const ensemble_score_t * meter_scores = &scores[i * model_count];
+        bool met;
+        int m = ensemble_select(meter_scores, model_bytes.data(), model_count, -1, target, &met);
+        chosen[m]++;
+        fleet_bytes += model_bytes[m];
+        met_count += met;
+        if (output) {
+            write_row(file, meters[i], "-", paths[m].c_str(), models[m], model_bytes[m],
+                      ensemble_skip_rate(&meter_scores[m], -1), met);
+        }
+        for (int b = 0; buckets > 1 && output && b < buckets; ++b) {
+            int bucket_model = ensemble_select(meter_scores, model_bytes.data(), model_count, b, target, &met);
+            std::string bucket = std::to_string(b);
+            write_row(file, meters[i], bucket.c_str(), paths[bucket_model].c_str(), models[bucket_model],
+                      model_bytes[bucket_model], ensemble_skip_rate(&meter_scores[bucket_model], b), met);
+        }
+    }
+    if (output) {
+        fclose(file);
+    }
+
+    printf("Target %.2f met on %d of %zu meters, model flash %zu bytes over the fleet\n",
+           target, met_count, meters.size(), fleet_bytes);
+    for (int m = 0; m < model_count; ++m) {
+        if (chosen[m]) {
+            printf("  %s: %d meters\n", paths[m].c_str(), chosen[m]);
+        }
+    }
+    if (check) {
+        printf("%d replays differ from model_replay\n", mismatches);
+    }
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,99 @@
+//
+// NUMA topology from sysfs and thread placement, without libnuma.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sched.h>
+#include <string>
+
+#include "numa.h"
+
+/**
+ * Parses a sysfs CPU list such as "0-3,8,10-11", keeping the CPUs of allowed
+ */
+static void parse_cpulist(const char * text, const cpu_set_t * allowed, std::vector<int> * cpus) {
+    const char * cursor = text;
+    while (*cursor >= '0' && *cursor <= '9') {
+        char * end;
+        long first = strtol(cursor, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, allowed)) {
+                cpus->push_back((int) cpu);
+            }
+        }
+        cursor = *end == ',' ? end + 1 : end;
+    }
+}
+
+int numa_topology(std::vector<numa_node_t> * nodes) {
+    nodes->clear();
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            CPU_SET(cpu, &allowed);
+        }
+    }
+
+    DIR * directory = opendir("/sys/devices/system/node");
+    if (directory) {
+        struct dirent * entry;
+        while ((entry = readdir(directory)) != NULL) {
+            if (strncmp(entry->d_name, "node", 4) != 0 || entry->d_name[4] < '0' || entry->d_name[4] > '9') {
+                continue;
+            }
+            std::string path = std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist";
+            FILE * file = fopen(path.c_str(), "r");
+            if (!file) {
+                continue;
+            }
+            char text[1024] = "";
+            if (fgets(text, sizeof(text), file)) {
+                numa_node_t node;
+                node.id = atoi(entry->d_name + 4);
+                parse_cpulist(text, &allowed, &node.cpus);
+                // Memory only nodes and nodes outside the affinity mask cannot run a shard
+                if (!node.cpus.empty()) {
+                    nodes->push_back(node);
+                }
+            }
+            fclose(file);
+        }
+        closedir(directory);
+    }
+
+    if (nodes->empty()) {
+        numa_node_t node;
+        node.id = 0;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        nodes->push_back(node);
+    }
+
+    // readdir order is arbitrary
+    std::sort(nodes->begin(), nodes->end(), [](const numa_node_t & a, const numa_node_t & b) {
+        return a.id < b.id;
+    });
+    return (int) nodes->size();
+}
+
+int numa_pin(const numa_node_t * node) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node->cpus) {
+        CPU_SET(cpu, &set);
+    }
+    // pid 0 is the calling thread
+    return sched_setaffinity(0, sizeof(set), &set) < 0 ? -1 : 0;
+}
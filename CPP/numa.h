@@ -0,0 +1,32 @@
+//
+// NUMA topology from sysfs and thread placement, without libnuma.
+//
+// Memory is placed by first touch: a thread pinned to a node before it allocates and writes
+// its data gets pages of that node under the default Linux policy.
+//
+
+#ifndef CPP_NUMA_H
+#define CPP_NUMA_H
+
+#include <vector>
+
+struct numa_node_t {
+    int id;
+    std::vector<int> cpus;      // CPUs of the node this process may run on
+};
+
+/**
+ * Reads /sys/devices/system/node, keeping the CPUs of the process affinity mask. Without
+ * NUMA information (no sysfs, a single node, containers) a single node holding every
+ * allowed CPU is returned.
+ * Returns the number of nodes, at least 1
+ */
+int numa_topology(std::vector<numa_node_t> * nodes);
+
+/**
+ * Restricts the calling thread to the CPUs of node
+ * Returns 0, -1 if the affinity cannot be set
+ */
+int numa_pin(const numa_node_t * node);
+
+#endif //CPP_NUMA_H
@@ -0,0 +1,18 @@
+//
+// Command line helpers shared by the host tools.
+//
+
+#include <cstdlib>
+
+#include "options.h"
+
+void options_parse_list(const char * text, std::vector<float> * values) {
+    values->clear();
+    char * end;
+    for (const char * cursor = text; *cursor; cursor = *end ? end + 1 : end) {
+        values->push_back((float) strtod(cursor, &end));
+        if (end == cursor) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,16 @@
+//
+// Command line helpers shared by the host tools.
+//
+
+#ifndef CPP_OPTIONS_H
+#define CPP_OPTIONS_H
+
+#include <vector>
+
+/**
+ * Parses a comma separated list of numbers, "0.05,0.1,0.3", stopping at the first that is not one
+ * values - replaced by the list
+ */
+void options_parse_list(const char * text, std::vector<float> * values);
+
+#endif //CPP_OPTIONS_H
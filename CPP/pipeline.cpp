@@ -0,0 +1,138 @@
+//
+// Chunked preprocessing of whole series into supervised tensors.
+//
+
+#include <cstdlib>
+#include <cstring>
+
+#include "deterministic.h"
+#include "pipeline.h"
+
+#if defined(__GNUC__)
+// Four float lanes, SSE on x86, NEON on ARM, plain IEEE operations on each lane
+typedef float lanes_t __attribute__((vector_size(16)));
+#define LANES 4
+
+static inline lanes_t lanes_load(const float * source) {
+    lanes_t lanes;
+    memcpy(&lanes, source, sizeof(lanes));
+    return lanes;
+}
+
+static inline void lanes_store(float * destination, lanes_t lanes) {
+    memcpy(destination, &lanes, sizeof(lanes));
+}
+
+static inline lanes_t lanes_set(float value) {
+    lanes_t lanes = {value, value, value, value};
+    return lanes;
+}
+#else
+#define LANES 0
+#endif
+
+float * pipeline_alloc(int count) {
+    void * buffer = NULL;
+    size_t size = ((count * sizeof(float) + PIPELINE_ALIGNMENT - 1) / PIPELINE_ALIGNMENT) * PIPELINE_ALIGNMENT;
+    if (posix_memalign(&buffer, PIPELINE_ALIGNMENT, size ? size : PIPELINE_ALIGNMENT) != 0) {
+        return NULL;
+    }
+    return (float *) buffer;
+}
+
+void pipeline_free(float * buffer) {
+    free(buffer);
+}
+
+void pipeline_init(pipeline_t * pipeline, const scaler_t * scaler) {
+    pipeline->scaler = *scaler;
+    pipeline->previous = 0;
+    pipeline->previous_diff = 0;
+    pipeline->started = false;
+}
+
+/**
+ * output[k] = scale_value(input[k]), in place allowed
+ */
+static void scale_block(const scaler_t * scaler, const float * input, float * output, int count) {
+    const float x_min = scaler->x_min;
+    const float x_range = scaler->x_max - scaler->x_min;
+    const float t_min = scaler->tx_min;
+    const float t_range = scaler->tx_max - scaler->tx_min;
+    int k = 0;
+#if LANES
+    const lanes_t x_min_lanes = lanes_set(x_min);
+    const lanes_t x_range_lanes = lanes_set(x_range);
+    const lanes_t t_min_lanes = lanes_set(t_min);
+    const lanes_t t_range_lanes = lanes_set(t_range);
+    for (; k + LANES <= count; k += LANES) {
+        lanes_t x = lanes_load(input + k);
+        lanes_store(output + k, (x - x_min_lanes) / x_range_lanes * t_range_lanes + t_min_lanes);
+    }
+#endif
+    for (; k < count; ++k) {
+        output[k] = (input[k] - x_min) / x_range * t_range + t_min;
+    }
+}
+
+int pipeline_push(pipeline_t * pipeline, const float * values, int count, float * inputs, float * targets) {
+    if (count <= 0) {
+        return 0;
+    }
+    if (!pipeline->started) {
+        // The first value of a series only serves as base of the first difference
+        pipeline->previous = values[0];
+        pipeline->previous_diff = 0;
+        pipeline->started = true;
+        values++;
+        count--;
+        if (count == 0) {
+            return 0;
+        }
+    }
+
+    // Raw differences, computed in targets
+    targets[0] = values[0] - pipeline->previous;
+    int k = 1;
+#if LANES
+    for (; k + LANES <= count; k += LANES) {
+        lanes_store(targets + k, lanes_load(values + k) - lanes_load(values + k - 1));
+    }
+#endif
+    for (; k < count; ++k) {
+        targets[k] = values[k] - values[k - 1];
+    }
+    float last_diff = targets[count - 1];
+
+    // The input of each pair is the target of the previous one
+    scale_block(&pipeline->scaler, targets, targets, count);
+    inputs[0] = scale_value(&pipeline->scaler, pipeline->previous_diff);
+    memcpy(inputs + 1, targets, (count - 1) * sizeof(float));
+
+    pipeline->previous = values[count - 1];
+    pipeline->previous_diff = last_diff;
+    return count;
+}
+
+void pipeline_invert(const scaler_t * scaler, const float * outputs, const float * previous, float * forecast,
+                     int count) {
+    const float x_min = scaler->x_min;
+    const float x_range = scaler->x_max - scaler->x_min;
+    const float t_min = scaler->tx_min;
+    const float t_range = scaler->tx_max - scaler->tx_min;
+    int k = 0;
+#if LANES
+    const lanes_t x_min_lanes = lanes_set(x_min);
+    const lanes_t x_range_lanes = lanes_set(x_range);
+    const lanes_t t_min_lanes = lanes_set(t_min);
+    const lanes_t t_range_lanes = lanes_set(t_range);
+    for (; k + LANES <= count; k += LANES) {
+        lanes_t y = lanes_load(outputs + k);
+        lanes_t diff = (y - t_min_lanes) / t_range_lanes * x_range_lanes + x_min_lanes;
+        lanes_store(forecast + k, diff + lanes_load(previous + k));
+    }
+#endif
+    for (; k < count; ++k) {
+        forecast[k] = (outputs[k] - t_min) / t_range * x_range + x_min + previous[k];
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Chunked preprocessing of whole series into supervised tensors: difference, scale and
+// frame as (previous difference, next difference) pairs, the notebooks' difference, scale
+// and timeseries_to_supervised(lag=1) in one pass. And back, inverse scale and difference.
+//
+// Loops run four lanes at a time with the expressions of scale_value/invert_scale_value in
+// the same order, so results are bit-identical to the per sample node code.
+//
+
+#ifndef CPP_PIPELINE_H
+#define CPP_PIPELINE_H
+
+#include "preprocess.h"
+
+// Alignment of tensors handed out by pipeline_alloc, one cache line
+#define PIPELINE_ALIGNMENT 64
+
+struct pipeline_t {
+    scaler_t scaler;
+    float previous;             // last raw value seen
+    float previous_diff;        // last difference, input of the next pair
+    bool started;
+};
+
+/**
+ * Aligned float buffer, released with pipeline_free
+ */
+float * pipeline_alloc(int count);
+
+void pipeline_free(float * buffer);
+
+/**
+ * Starts a series, scaled with scaler
+ */
+void pipeline_init(pipeline_t * pipeline, const scaler_t * scaler);
+
+/**
+ * Appends count raw values and writes one supervised pair per value but the very first of
+ * the series: inputs[k] is the scaled difference preceding targets[k] (0 for the first pair,
+ * the notebooks' fillna(0)), targets[k] the scaled difference to predict.
+ * Returns the number of pairs written, count or count - 1.
+ */
+int pipeline_push(pipeline_t * pipeline, const float * values, int count, float * inputs, float * targets);
+
+/**
+ * Forecasts from scaled model outputs: forecast[k] = invert_scale(outputs[k]) + previous[k]
+ */
+void pipeline_invert(const scaler_t * scaler, const float * outputs, const float * previous, float * forecast,
+                     int count);
+
+#endif //CPP_PIPELINE_H
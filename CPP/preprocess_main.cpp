@@ -0,0 +1,142 @@
+//
+// Preprocesses every meter of a dataset export into supervised tensors.
+//
+// preprocess [-d dataset.csv] [-k chunk] [-o tensors.bin]
+//
+// Each meter is streamed through the pipeline chunk by chunk with its own fitted scaler,
+// checked bit for bit against the per sample preprocess.h path and timed against it.
+// With -o the tensors are written for training or replay, per meter: a 64 byte header
+// (square, country, pair count, scaler) then inputs and targets, each padded to 64 bytes.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "dataset.h"
+#include "pipeline.h"
+#include "trainer.h"
+
+struct tensor_header_t {
+    long long square;
+    int country;
+    int count;
+    scaler_t scaler;
+    char padding[PIPELINE_ALIGNMENT - sizeof(long long) - 2 * sizeof(int) - sizeof(scaler_t)];
+};
+
+static int write_padded(FILE * file, const float * values, int count) {
+    static const char zeros[PIPELINE_ALIGNMENT] = {0};
+    size_t bytes = count * sizeof(float);
+    size_t padding = (PIPELINE_ALIGNMENT - bytes % PIPELINE_ALIGNMENT) % PIPELINE_ALIGNMENT;
+    if (fwrite(values, 1, bytes, file) != bytes || fwrite(zeros, 1, padding, file) != padding) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char ** argv) {
+    const char * path = "../Python/dataset.csv";
+    const char * output = NULL;
+    int chunk = 4096;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-d")) {
+            path = argv[i + 1];
+        } else if (!strcmp(argv[i], "-k")) {
+            chunk = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-o")) {
+            output = argv[i + 1];
+        } else {
+            fprintf(stderr, "usage: preprocess [-d dataset.csv] [-k chunk] [-o tensors.bin]\n");
+            return 1;
+        }
+    }
+    if (chunk < 1) {
+        fprintf(stderr, "Chunk must be positive\n");
+        return 1;
+    }
+
+    std::vector<meter_series_t> meters;
+    if (dataset_load(path, DATASET_VALUE_COLUMN, &meters) < 0) {
+        return 1;
+    }
+    FILE * file = NULL;
+    if (output && !(file = fopen(output, "wb"))) {
+        fprintf(stderr, "Cannot write %s\n", output);
+        return 1;
+    }
+
+    double pipeline_ns = 0;
+    double reference_ns = 0;
+    long pairs = 0;
+    int mismatches = 0;
+    for (const meter_series_t & meter : meters) {
+        int length = (int) meter.values.size();
+        const float * values = meter.values.data();
+        scaler_t scaler = train_fit_scaler(values, length);
+
+        float * inputs = pipeline_alloc(length);
+        float * targets = pipeline_alloc(length);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pipeline_t pipeline;
+        pipeline_init(&pipeline, &scaler);
+        int count = 0;
+        for (int offset = 0; offset < length; offset += chunk) {
+            int size = length - offset < chunk ? length - offset : chunk;
+            count += pipeline_push(&pipeline, values + offset, size, inputs + count, targets + count);
+        }
+        pipeline_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        // Per sample reference, as the node computes it
+        std::vector<float> reference_inputs(length);
+        std::vector<float> reference_targets(length);
+        start = std::chrono::steady_clock::now();
+        differencer_t differencer;
+        float previous_diff = 0;
+        for (int i = 0; i < length; ++i) {
+            if (i == 0) {
+                difference_init(&differencer, values[0]);
+                continue;
+            }
+            float diff = difference_push(&differencer, values[i]);
+            reference_inputs[i - 1] = scale_value(&scaler, previous_diff);
+            reference_targets[i - 1] = scale_value(&scaler, diff);
+            previous_diff = diff;
+        }
+        reference_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if (count != (length > 0 ? length - 1 : 0)
+            || memcmp(inputs, reference_inputs.data(), count * sizeof(float)) != 0
+            || memcmp(targets, reference_targets.data(), count * sizeof(float)) != 0) {
+            fprintf(stderr, "Square %lld country %d: pipeline differs from preprocess.h\n", meter.square, meter.country);
+            mismatches++;
+        }
+        pairs += count;
+
+        if (file) {
+            tensor_header_t header;
+            memset(&header, 0, sizeof(header));
+            header.square = meter.square;
+            header.country = meter.country;
+            header.count = count;
+            header.scaler = scaler;
+            if (fwrite(&header, sizeof(header), 1, file) != 1 || write_padded(file, inputs, count) < 0
+                || write_padded(file, targets, count) < 0) {
+                fprintf(stderr, "Cannot write %s\n", output);
+                mismatches++;
+            }
+        }
+        pipeline_free(inputs);
+        pipeline_free(targets);
+    }
+    if (file) {
+        fclose(file);
+    }
+
+    printf("%zu meters, %ld pairs, pipeline %.2f ns/pair, per sample %.2f ns/pair, %d mismatches\n",
+           meters.size(), pairs, pairs ? pipeline_ns / pairs : 0.0, pairs ? reference_ns / pairs : 0.0, mismatches);
+    return mismatches ? 2 : 0;
+}
@@ -0,0 +1,278 @@
+//
+// Record and compare per step traces of the dual prediction over conso_data, to check a new
+// kernel against the exact one before it ships.
+//
+// replay record [-k kernel] [-m model.h] [-t threshold] trace.bin
+// replay compare [-k kernel] [-m model.h] [-a absolute] [-r relative] [-w window] [-c] trace.bin
+//
+// record writes the trace of a reference run; with the compiled model it must reproduce the
+// conformance hash. compare replays conso_data with another kernel or model and reports the
+// largest and mean error of every field, the error per window of steps (how it drifts), the
+// first value out of tolerance and the transmission decisions that changed. The kernel is fed
+// the reference's reconstructed series unless -c runs it closed loop, as a node would.
+// Exits with 1 when a value is out of tolerance or a decision changed.
+//
+// Kernels: handmade (lstmCellSimple/dense_nn), generated (kernel_step/kernel_dense, compiled
+// model only), model (model_step/model_dense), runtime (runtime_step). The default is the one
+// dual prediction is built with. A new kernel is one more entry of kernels[].
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "conformance.h"
+#include "conso_data.h"
+#include "handmade.h"
+#include "kernel.h"
+#include "parameters.h"
+#include "runtime.h"
+#include "trace.h"
+
+static float handmade_kernel(const lstm_model_t * model, void * context, float input, float * hidden_layer,
+                             float * cell_states) {
+    (void) context;
+    lstmCellSimple(input, model->input_weights.data(), model->hidden_weights.data(), model->bias.data(),
+                   hidden_layer, cell_states);
+    return dense_nn(hidden_layer, model->dense_weights.data(), model->dense_bias);
+}
+
+#ifdef GENERATED_KERNEL
+static float generated_kernel(const lstm_model_t * model, void * context, float input, float * hidden_layer,
+                              float * cell_states) {
+    (void) model;
+    (void) context;
+    kernel_step(input, hidden_layer, cell_states);
+    return kernel_dense(hidden_layer);
+}
+#endif
+
+static float model_kernel(const lstm_model_t * model, void * context, float input, float * hidden_layer,
+                          float * cell_states) {
+    (void) context;
+    model_step(model, input, hidden_layer, cell_states);
+    return model_dense(model, hidden_layer);
+}
+
+/**
+ * Lane 0 of a runtime, its state swapped in and out around the step
+ */
+static float runtime_kernel(const lstm_model_t * model, void * context, float input, float * hidden_layer,
+                            float * cell_states) {
+    runtime_t * runtime = (runtime_t *) context;
+    memcpy(runtime->hidden_layer, hidden_layer, model->hunit * sizeof(float));
+    memcpy(runtime->cell_states, cell_states, model->hunit * sizeof(float));
+    float output;
+    runtime_step(runtime, 0, 1, &input, &output);
+    memcpy(hidden_layer, runtime->hidden_layer, model->hunit * sizeof(float));
+    memcpy(cell_states, runtime->cell_states, model->hunit * sizeof(float));
+    return output;
+}
+
+struct kernel_entry_t {
+    const char * name;
+    float (*step)(const lstm_model_t *, void *, float, float *, float *);
+    bool compiled_only;     // weights of parameters.h built in, cannot run a model file
+    bool fixed_hunit;       // runs HUNIT units only
+};
+
+static const kernel_entry_t kernels[] = {
+        {"handmade",  handmade_kernel,  false, true},
+#ifdef GENERATED_KERNEL
+        {"generated", generated_kernel, true,  true},
+#endif
+        {"model",     model_kernel,     false, false},
+        {"runtime",   runtime_kernel,   false, false},
+};
+
+static int usage() {
+    fprintf(stderr, "usage: replay record [-k kernel] [-m model.h] [-t threshold] trace.bin\n"
+                    "       replay compare [-k kernel] [-m model.h] [-a absolute] [-r relative] [-w window] [-c]"
+                    " trace.bin\n");
+    return 1;
+}
+
+static void print_report(const trace_report_t & report, double absolute, double relative) {
+    int fields = report.states ? TRACE_FIELDS : TRACE_HIDDEN;
+
+    printf("\n%-14s %12s %12s %8s\n", "Field", "Max error", "Mean error", "At step");
+    for (int f = 0; f < fields; ++f) {
+        const trace_error_t & error = report.errors[f];
+        printf("%-14s %12.4g %12.4g %8d\n", trace_field_name(f), error.max,
+               report.steps ? error.sum / report.steps : 0.0, error.at);
+    }
+
+    printf("\n%-14s", "Steps");
+    for (int f = 0; f < fields; ++f) {
+        printf(" %12s", trace_field_name(f));
+    }
+    printf("\n");
+    for (size_t w = 0; w * TRACE_FIELDS < report.windows.size(); ++w) {
+        int first = (int) w * report.window;
+        int last = first + report.window - 1 < report.steps - 1 ? first + report.window - 1 : report.steps - 1;
+        char steps[32];
+        snprintf(steps, sizeof(steps), "%d-%d", first, last);
+        printf("%-14s", steps);
+        for (int f = 0; f < fields; ++f) {
+            printf(" %12.4g", report.windows[w * TRACE_FIELDS + f].max);
+        }
+        printf("\n");
+    }
+
+    printf("\nTolerance %g + %g * |reference|: ", absolute, relative);
+    if (report.first.step < 0) {
+        printf("every value within\n");
+    } else {
+        const trace_divergence_t & first = report.first;
+        printf("%d steps out, first at step %d, %s", report.divergent, first.step, trace_field_name(first.field));
+        if (first.field == TRACE_HIDDEN || first.field == TRACE_CELL) {
+            printf("[%d]", first.component);
+        }
+        printf(" %.9g instead of %.9g\n", first.value, first.reference);
+    }
+    printf("Transmitted %d, reference %d", report.sent, report.reference_sent);
+    if (report.decisions) {
+        printf(", %d decisions changed, first at step %d\n", report.decisions, report.decision_first);
+    } else {
+        printf(", every decision kept\n");
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc < 2 || (strcmp(argv[1], "record") != 0 && strcmp(argv[1], "compare") != 0)) {
+        return usage();
+    }
+    bool record = !strcmp(argv[1], "record");
+#ifdef GENERATED_KERNEL
+    const char * kernel_name = "generated";
+#else
+    const char * kernel_name = "handmade";
+#endif
+    const char * model_path = NULL;
+    const char * path = NULL;
+    float threshold = 0.3f;
+    double absolute = 0;
+    double relative = 0;
+    int window = 100;
+    bool closed_loop = false;
+
+    for (int i = 2; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "-k") && has_value) {
+            kernel_name = argv[++i];
+        } else if (!strcmp(argv[i], "-m") && has_value) {
+            model_path = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && has_value && record) {
+            threshold = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-a") && has_value && !record) {
+            absolute = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && has_value && !record) {
+            relative = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-w") && has_value && !record) {
+            window = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-c") && !record) {
+            closed_loop = true;
+        } else if (argv[i][0] == '-' || path) {
+            return usage();
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path || window < 1) {
+        return usage();
+    }
+
+    const kernel_entry_t * entry = NULL;
+    for (const kernel_entry_t & candidate : kernels) {
+        if (!strcmp(candidate.name, kernel_name)) {
+            entry = &candidate;
+        }
+    }
+    if (!entry) {
+        fprintf(stderr, "Unknown kernel %s, one of:", kernel_name);
+        for (const kernel_entry_t & candidate : kernels) {
+            fprintf(stderr, " %s", candidate.name);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    lstm_model_t model;
+    if (model_path) {
+        if (entry->compiled_only) {
+            fprintf(stderr, "The %s kernel only runs the compiled model\n", entry->name);
+            return 1;
+        }
+        if (model_load(&model, model_path) < 0) {
+            return 1;
+        }
+        if (entry->fixed_hunit && model.hunit != HUNIT) {
+            fprintf(stderr, "The %s kernel needs %d units, %s has %d\n", entry->name, HUNIT, model_path, model.hunit);
+            return 1;
+        }
+    } else {
+        model_from_parameters(&model);
+    }
+
+    runtime_t runtime;
+    bool runtime_used = entry->step == runtime_kernel;
+    if (runtime_used && runtime_create(&runtime, &model, 1, 0) < 0) {
+        fprintf(stderr, "Cannot create the runtime\n");
+        return 1;
+    }
+    trace_kernel_t kernel = {entry->name, &model, runtime_used ? &runtime : NULL, entry->step};
+    const int length = sizeof(conso_data) / sizeof(conso_data[0]);
+    int status = 0;
+
+    if (record) {
+        trace_t trace;
+        trace_record(&kernel, conso_data, length, threshold, NULL, &trace);
+        uint32_t hash = trace_hash(&trace);
+        int transmitted = 0;
+        for (int i = 0; i < length; ++i) {
+            transmitted += trace.sent[i];
+        }
+        printf("Kernel %s, %s: %d steps, %d transmitted, hash %08lx\n", entry->name,
+               model_path ? model_path : "compiled model", length, transmitted, (unsigned long) hash);
+
+#if !defined(ONLINE_DENSE) && !defined(ANOMALY_GATE)
+        // Both replay the same dual prediction, a kernel of the compiled model must agree bit for bit
+        if (!model_path) {
+            uint32_t expected = conformance_replay(conso_data, length, threshold, NULL);
+            if (hash != expected) {
+                fprintf(stderr, "Does not reproduce the conformance hash %08lx\n", (unsigned long) expected);
+                status = 1;
+            }
+        }
+#endif
+        if (status == 0 && trace_save(&trace, path) < 0) {
+            status = 1;
+        }
+    } else {
+        trace_t reference;
+        trace_t trace;
+        trace_report_t report;
+        if (trace_load(&reference, path) < 0) {
+            status = 1;
+        } else if (trace_record(&kernel, conso_data, length, reference.threshold, closed_loop ? NULL : &reference,
+                                &trace) < 0
+                   || trace_compare(&reference, &trace, absolute, relative, window, &report) < 0) {
+            fprintf(stderr, "%s was not recorded over conso_data\n", path);
+            status = 1;
+        } else {
+            printf("Kernel %s, %s against %s, threshold %.2f, %s\n", entry->name,
+                   model_path ? model_path : "compiled model", path, reference.threshold,
+                   closed_loop ? "closed loop" : "fed the reference series");
+            if (!report.states) {
+                printf("%d units against %d, h and c not compared\n", trace.hunit, reference.hunit);
+            }
+            print_report(report, absolute, relative);
+            status = report.first.step >= 0 || report.decisions > 0 ? 1 : 0;
+        }
+    }
+
+    if (runtime_used) {
+        runtime_destroy(&runtime);
+    }
+    return status;
+}
@@ -0,0 +1,172 @@
+//
+// Allocation free inference runtime over a single arena.
+//
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "deterministic.h"
+#include "handmade.h"
+#include "runtime.h"
+
+/**
+ * Bytes of count floats, rounded up to the section alignment
+ */
+static size_t section(size_t count) {
+    size_t bytes = count * sizeof(float);
+    return (bytes + RUNTIME_ALIGNMENT - 1) / RUNTIME_ALIGNMENT * RUNTIME_ALIGNMENT;
+}
+
+size_t runtime_arena_size(int hunit, int lanes, int forks) {
+    size_t slots = lanes + forks;
+    return section(4 * hunit) + section(4 * hunit * hunit) + section(4 * hunit) + 3 * section(hunit)
+           + 2 * section(slots * hunit) + section(4 * hunit);
+}
+
+/**
+ * Hands out the next section of the arena
+ */
+static float * take(unsigned char ** cursor, size_t count) {
+    float * section_start = (float *) *cursor;
+    *cursor += section(count);
+    return section_start;
+}
+
+int runtime_init(runtime_t * runtime, const lstm_model_t * model, int lanes, int forks, void * arena, size_t size) {
+    const int hunit = model->hunit;
+    if (hunit < 1 || hunit > MODEL_MAX_HUNIT || lanes < 1 || forks < 0
+        || size < runtime_arena_size(hunit, lanes, forks) || (uintptr_t) arena % RUNTIME_ALIGNMENT) {
+        return -1;
+    }
+    runtime->hunit = hunit;
+    runtime->lanes = lanes;
+    runtime->forks = forks;
+    runtime->scaler_folded = model->scaler_folded;
+    runtime->dense_bias = model->dense_bias;
+    runtime->scaler = model->scaler;
+    runtime->arena = arena;
+    runtime->size = size;
+    runtime->owned = false;
+
+    unsigned char * cursor = (unsigned char *) arena;
+    runtime->input_weights = take(&cursor, 4 * hunit);
+    runtime->hidden_weights = take(&cursor, 4 * hunit * hunit);
+    runtime->bias = take(&cursor, 4 * hunit);
+    runtime->dense_weights = take(&cursor, hunit);
+    runtime->initial_hidden = take(&cursor, hunit);
+    runtime->initial_cells = take(&cursor, hunit);
+    runtime->hidden_layer = take(&cursor, (lanes + forks) * hunit);
+    runtime->cell_states = take(&cursor, (lanes + forks) * hunit);
+    runtime->gates = take(&cursor, 4 * hunit);
+
+    memcpy(runtime->input_weights, model->input_weights.data(), 4 * hunit * sizeof(float));
+    memcpy(runtime->hidden_weights, model->hidden_weights.data(), 4 * hunit * hunit * sizeof(float));
+    memcpy(runtime->bias, model->bias.data(), 4 * hunit * sizeof(float));
+    memcpy(runtime->dense_weights, model->dense_weights.data(), hunit * sizeof(float));
+    memcpy(runtime->initial_hidden, model->hidden_layer.data(), hunit * sizeof(float));
+    memcpy(runtime->initial_cells, model->cell_states.data(), hunit * sizeof(float));
+    for (int slot = 0; slot < lanes + forks; ++slot) {
+        runtime_reset(runtime, slot);
+    }
+    return 0;
+}
+
+int runtime_create(runtime_t * runtime, const lstm_model_t * model, int lanes, int forks) {
+    if (model->hunit < 1 || model->hunit > MODEL_MAX_HUNIT || lanes < 1 || forks < 0) {
+        return -1;
+    }
+    size_t size = runtime_arena_size(model->hunit, lanes, forks);
+    void * arena = NULL;
+    if (posix_memalign(&arena, RUNTIME_ALIGNMENT, size) != 0) {
+        return -1;
+    }
+    if (runtime_init(runtime, model, lanes, forks, arena, size) < 0) {
+        free(arena);
+        return -1;
+    }
+    runtime->owned = true;
+    return 0;
+}
+
+void runtime_destroy(runtime_t * runtime) {
+    if (runtime->owned) {
+        free(runtime->arena);
+    }
+    runtime->arena = NULL;
+    runtime->owned = false;
+}
+
+void runtime_reset(runtime_t * runtime, int slot) {
+    const int hunit = runtime->hunit;
+    memcpy(runtime->hidden_layer + slot * hunit, runtime->initial_hidden, hunit * sizeof(float));
+    memcpy(runtime->cell_states + slot * hunit, runtime->initial_cells, hunit * sizeof(float));
+}
+
+void runtime_fork(runtime_t * runtime, int from, int to) {
+    const int hunit = runtime->hunit;
+    memcpy(runtime->hidden_layer + to * hunit, runtime->hidden_layer + from * hunit, hunit * sizeof(float));
+    memcpy(runtime->cell_states + to * hunit, runtime->cell_states + from * hunit, hunit * sizeof(float));
+}
+
+void runtime_step(runtime_t * runtime, int first, int count, const float * inputs, float * outputs) {
+    const int hunit = runtime->hunit;
+    const float * input_weights = runtime->input_weights;
+    const float * hidden_weights = runtime->hidden_weights;
+    const float * bias = runtime->bias;
+    float * input_gate = runtime->gates + 0 * hunit;
+    float * forget_gate = runtime->gates + 1 * hunit;
+    float * cell_candidate = runtime->gates + 2 * hunit;
+    float * output_gate = runtime->gates + 3 * hunit;
+
+    for (int k = 0; k < count; ++k) {
+        const float input = inputs[k];
+        float * hidden_layer = runtime->hidden_layer + (first + k) * hunit;
+        float * cell_states = runtime->cell_states + (first + k) * hunit;
+
+        for (int i = 0; i < hunit; ++i) {
+            input_gate[i] = input_weights[0 * hunit + i] * input;
+            forget_gate[i] = input_weights[1 * hunit + i] * input;
+            cell_candidate[i] = input_weights[2 * hunit + i] * input;
+            output_gate[i] = input_weights[3 * hunit + i] * input;
+
+            for (int j = 0; j < hunit; ++j) {
+                input_gate[i] += hidden_weights[(0 * hunit + i) * hunit + j] * hidden_layer[j];
+                forget_gate[i] += hidden_weights[(1 * hunit + i) * hunit + j] * hidden_layer[j];
+                cell_candidate[i] += hidden_weights[(2 * hunit + i) * hunit + j] * hidden_layer[j];
+                output_gate[i] += hidden_weights[(3 * hunit + i) * hunit + j] * hidden_layer[j];
+            }
+
+            input_gate[i] += bias[0 * hunit + i];
+            forget_gate[i] += bias[1 * hunit + i];
+            cell_candidate[i] += bias[2 * hunit + i];
+            output_gate[i] += bias[3 * hunit + i];
+
+            input_gate[i] = sigmoid_function(input_gate[i]);
+            forget_gate[i] = sigmoid_function(forget_gate[i]);
+            cell_candidate[i] = sigmoid_function(cell_candidate[i]);
+            output_gate[i] = sigmoid_function(output_gate[i]);
+        }
+
+        float output = 0;
+        for (int i = 0; i < hunit; ++i) {
+            cell_states[i] = forget_gate[i] * cell_states[i] + input_gate[i] * cell_candidate[i];
+            hidden_layer[i] = output_gate[i] * tanh_function(cell_states[i]);
+        }
+        for (int i = 0; i < hunit; ++i) {
+            output += hidden_layer[i] * runtime->dense_weights[i];
+        }
+        outputs[k] = output + runtime->dense_bias;
+    }
+}
+
+void runtime_forecast(runtime_t * runtime, int lane, int fork, float diff, int horizon, float * deltas) {
+    runtime_fork(runtime, lane, fork);
+    for (int h = 0; h < horizon; ++h) {
+        float input = runtime->scaler_folded ? diff : scale_value(&runtime->scaler, diff);
+        float output;
+        runtime_step(runtime, fork, 1, &input, &output);
+        diff = runtime->scaler_folded ? output : invert_scale_value(&runtime->scaler, output);
+        deltas[h] = diff;
+    }
+}
@@ -0,0 +1,90 @@
+//
+// Allocation free inference runtime over a single arena.
+//
+// A model, the state of every lane of a batch, the forecast forks and the gate scratch are
+// planned once into one 64 byte aligned block. Stepping never allocates, so a runtime sized
+// at start up can serve any number of steps, e.g. one lane per meter of a mirror.
+//
+// Slots 0..lanes-1 are the live lanes, slots lanes..lanes+forks-1 the forks: copies of a lane
+// state stepped ahead on the model's own forecasts without disturbing the lane.
+//
+
+#ifndef CPP_RUNTIME_H
+#define CPP_RUNTIME_H
+
+#include <cstddef>
+
+#include "model.h"
+
+// Alignment of the arena and of every section in it, one cache line
+#define RUNTIME_ALIGNMENT 64
+
+struct runtime_t {
+    int hunit;
+    int lanes;
+    int forks;
+    bool scaler_folded;
+    float dense_bias;
+    scaler_t scaler;
+
+    void * arena;               // owned when created with runtime_create
+    size_t size;
+    bool owned;
+
+    // Sections of the arena
+    float * input_weights;      // 4*hunit
+    float * hidden_weights;     // 4*hunit*hunit
+    float * bias;               // 4*hunit
+    float * dense_weights;      // hunit
+    float * initial_hidden;     // hunit
+    float * initial_cells;      // hunit
+    float * hidden_layer;       // (lanes + forks) * hunit
+    float * cell_states;        // (lanes + forks) * hunit
+    float * gates;              // 4*hunit, i, f, c, o of the slot being stepped
+};
+
+/**
+ * Bytes of arena a runtime of that shape needs
+ */
+size_t runtime_arena_size(int hunit, int lanes, int forks);
+
+/**
+ * Lays the runtime out in a caller provided arena and copies the model in, every slot
+ * starting from the model's initial state
+ * Returns 0, -1 if the arena is too small or not RUNTIME_ALIGNMENT aligned
+ */
+int runtime_init(runtime_t * runtime, const lstm_model_t * model, int lanes, int forks, void * arena, size_t size);
+
+/**
+ * runtime_init over an arena allocated here, the only allocation of the runtime
+ * Returns 0, -1 on allocation failure or unsupported model
+ */
+int runtime_create(runtime_t * runtime, const lstm_model_t * model, int lanes, int forks);
+
+void runtime_destroy(runtime_t * runtime);
+
+/**
+ * Puts slot back to the model's initial state
+ */
+void runtime_reset(runtime_t * runtime, int slot);
+
+/**
+ * Copies the state of slot from into slot to, typically a lane into a fork
+ */
+void runtime_fork(runtime_t * runtime, int from, int to);
+
+/**
+ * Steps slots first..first+count-1, inputs[k] feeding slot first + k, and writes the dense
+ * outputs. Same evaluation order as model_step/model_dense, so bit-identical to them.
+ * Inputs and outputs are in model space: scaled unless the scaler is folded.
+ */
+void runtime_step(runtime_t * runtime, int first, int count, const float * inputs, float * outputs);
+
+/**
+ * Forecasts horizon raw deltas ahead of a lane in fork: the lane state is copied in, then
+ * each forecast delta is fed back as the next input, as the server reconstructs skipped
+ * samples. diff - raw difference the lane would be fed next
+ */
+void runtime_forecast(runtime_t * runtime, int lane, int fork, float diff, int horizon, float * deltas);
+
+#endif //CPP_RUNTIME_H
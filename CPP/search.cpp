@@ -0,0 +1,272 @@
+//
+// Hyperparameter search over hidden size, learning rate, epochs, weight precision and threshold.
+//
+// search [-d dataset.csv] [-c country] [-e max epochs] [-p patience] [-w window] [-j threads]
+//        [-H hunits] [-r rates] [-P precisions] [-t thresholds]
+//
+// Lists are comma separated. Every (HUNIT, rate) pair is trained on its own thread, with
+// early stopping on the validation MAPE (the held out last third, as in the notebooks).
+// Each trained model is then rounded to every precision (decimal digits, np.around in
+// Courbe_Taille-Preci-Perf) and replayed in dual prediction at every threshold.
+//
+// Output: one CSV line per point, the Pareto front of skip rate vs. multiply-adds per step
+// vs. weight flash flagged for each threshold, since a larger threshold always skips more.
+//
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "cost_model.h"
+#include "dataset.h"
+#include "options.h"
+#include "trainer.h"
+
+struct trial_t {
+    train_config_t config;
+    lstm_model_t best;          // weights at the best validation MAPE
+    float best_mape;
+    int best_epoch;
+    int stale;                  // epochs since the best one
+};
+
+struct point_t {
+    const trial_t * trial;
+    int precision;              // decimal digits kept, 0 for full float
+    float threshold;
+    float mape;
+    float skip_rate;            // percent of validation samples not transmitted
+    long multiply_adds;         // per inference
+    long flash;                 // weight bytes
+    bool pareto;
+};
+
+struct search_t {
+    std::vector<trial_t> * trials;
+    std::atomic<size_t> next;
+    const std::vector<float> * series;
+    int train_length;
+    int patience;
+};
+
+struct epoch_context_t {
+    const search_t * search;
+    trial_t * trial;
+};
+
+static bool on_epoch(void * context, int epoch, const lstm_model_t * model, float loss) {
+    (void) loss;
+    epoch_context_t * state = (epoch_context_t *) context;
+    trial_t * trial = state->trial;
+    const std::vector<float> & series = *state->search->series;
+
+    float mape = model_mape(model, series.data(), (int) series.size(), state->search->train_length);
+    if (trial->best_epoch < 0 || mape < trial->best_mape) {
+        trial->best = *model;
+        trial->best_mape = mape;
+        trial->best_epoch = epoch;
+        trial->stale = 0;
+        return true;
+    }
+    return ++trial->stale < state->search->patience;
+}
+
+static void worker(search_t * search) {
+    for (;;) {
+        size_t index = search->next++;
+        if (index >= search->trials->size()) {
+            return;
+        }
+        trial_t & trial = (*search->trials)[index];
+        trial.best_epoch = -1;
+        trial.stale = 0;
+
+        epoch_context_t context = {search, &trial};
+        lstm_model_t model;
+        const std::vector<float> & series = *search->series;
+        train_lstm(&trial.config, series.data(), search->train_length, &model, on_epoch, &context);
+    }
+}
+
+/**
+ * Rounds the trained weights to digits decimals, np.around semantics (half to even)
+ */
+static void round_weights(lstm_model_t * model, int digits) {
+    double scale = pow(10.0, digits);
+    std::vector<float> * arrays[] = {&model->input_weights, &model->hidden_weights, &model->bias,
+                                     &model->dense_weights};
+    for (std::vector<float> * values : arrays) {
+        for (float & value : *values) {
+            value = (float) (nearbyint(value * scale) / scale);
+        }
+    }
+    model->dense_bias = (float) (nearbyint(model->dense_bias * scale) / scale);
+}
+
+/**
+ * Weight bytes if every array is stored as the narrowest signed fixed point integer holding
+ * digits decimals, float when 32 bits are needed anyway
+ */
+static long weight_flash(const lstm_model_t * model, int digits) {
+    long count = (long) (model->input_weights.size() + model->hidden_weights.size() + model->bias.size()
+                         + model->dense_weights.size() + 1);
+    if (digits <= 0) {
+        return count * 4;
+    }
+
+    double largest = fabs(model->dense_bias);
+    const std::vector<float> * arrays[] = {&model->input_weights, &model->hidden_weights, &model->bias,
+                                           &model->dense_weights};
+    for (const std::vector<float> * values : arrays) {
+        for (float value : *values) {
+            largest = fmax(largest, fabs(value));
+        }
+    }
+    int bits = (int) ceil(log2(largest * pow(10.0, digits) + 1)) + 1;
+    return count * (bits <= 8 ? 1 : bits <= 16 ? 2 : 4);
+}
+
+int main(int argc, char ** argv) {
+    const char * path = "../Python/dataset.csv";
+    int country = -1;
+    int epochs = 50;
+    int patience = 5;
+    int window = 32;
+    int threads = (int) std::thread::hardware_concurrency();
+    std::vector<float> hunits, rates, precisions, thresholds;
+    options_parse_list("1,2,3,4,6,8", &hunits);
+    options_parse_list("0.01,0.003,0.001", &rates);
+    options_parse_list("0,2,3,4,5,6", &precisions);
+    options_parse_list("0.05,0.1,0.15,0.3", &thresholds);
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char * value = argv[i + 1];
+        if (!strcmp(argv[i], "-d")) { path = value; }
+        else if (!strcmp(argv[i], "-c")) { country = atoi(value); }
+        else if (!strcmp(argv[i], "-e")) { epochs = atoi(value); }
+        else if (!strcmp(argv[i], "-p")) { patience = atoi(value); }
+        else if (!strcmp(argv[i], "-w")) { window = atoi(value); }
+        else if (!strcmp(argv[i], "-j")) { threads = atoi(value); }
+        else if (!strcmp(argv[i], "-H")) { options_parse_list(value, &hunits); }
+        else if (!strcmp(argv[i], "-r")) { options_parse_list(value, &rates); }
+        else if (!strcmp(argv[i], "-P")) { options_parse_list(value, &precisions); }
+        else if (!strcmp(argv[i], "-t")) { options_parse_list(value, &thresholds); }
+        else {
+            fprintf(stderr, "usage: search [-d dataset.csv] [-c country] [-e max epochs] [-p patience] "
+                            "[-w window] [-j threads] [-H hunits] [-r rates] [-P precisions] [-t thresholds]\n");
+            return 1;
+        }
+    }
+
+    std::vector<meter_series_t> meters;
+    if (dataset_load(path, DATASET_VALUE_COLUMN, &meters) < 0) {
+        return 1;
+    }
+    const meter_series_t * meter = NULL;
+    for (const meter_series_t & candidate : meters) {
+        if (country >= 0 ? candidate.country == country
+                         : !meter || candidate.values.size() > meter->values.size()) {
+            meter = &candidate;
+        }
+    }
+    if (!meter) {
+        fprintf(stderr, "No meter for country %d\n", country);
+        return 1;
+    }
+
+    std::vector<trial_t> trials;
+    for (float hunit : hunits) {
+        for (float rate : rates) {
+            trial_t trial = {};
+            trial.best_epoch = -1;
+            trial.config.hunit = (int) hunit;
+            trial.config.window = window;
+            trial.config.epochs = epochs;
+            trial.config.learning_rate = rate;
+            trial.config.seed = 1;
+            trials.push_back(trial);
+        }
+    }
+
+    int length = (int) meter->values.size();
+    search_t search;
+    search.trials = &trials;
+    search.next = 0;
+    search.series = &meter->values;
+    search.train_length = length - length / 3;
+    search.patience = patience;
+
+    fprintf(stderr, "%zu trainings x %zu precisions x %zu thresholds on square %lld country %d\n",
+            trials.size(), precisions.size(), thresholds.size(), meter->square, meter->country);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < (threads > 1 ? threads : 1) && i < (int) trials.size(); ++i) {
+        workers.push_back(std::thread(worker, &search));
+    }
+    for (std::thread & thread : workers) {
+        thread.join();
+    }
+
+    // Every trained model at every precision and threshold
+    const float * series = meter->values.data();
+    int validation = length - search.train_length;
+    std::vector<point_t> points;
+    for (const trial_t & trial : trials) {
+        if (trial.best_epoch < 0) {
+            fprintf(stderr, "Invalid configuration HUNIT %d\n", trial.config.hunit);
+            continue;
+        }
+        for (float precision : precisions) {
+            lstm_model_t model = trial.best;
+            if (precision > 0) {
+                round_weights(&model, (int) precision);
+            }
+            float mape = model_mape(&model, series, length, search.train_length);
+            model_cost_t cost;
+            cost_analyse(&model, &cost);
+            for (float threshold : thresholds) {
+                point_t point;
+                point.trial = &trial;
+                point.precision = (int) precision;
+                point.threshold = threshold;
+                point.mape = mape;
+                int transmitted = model_replay(&model, series, length, search.train_length, threshold, NULL, NULL);
+                point.skip_rate = 100.0f * (validation - transmitted) / validation;
+                point.multiply_adds = cost.macs;
+                point.flash = weight_flash(&model, (int) precision);
+                point.pareto = false;
+                points.push_back(point);
+            }
+        }
+    }
+
+    // Non dominated points among those sharing a threshold
+    for (point_t & point : points) {
+        point.pareto = true;
+        for (const point_t & other : points) {
+            if (other.threshold != point.threshold) {
+                continue;
+            }
+            bool no_worse = other.skip_rate >= point.skip_rate && other.multiply_adds <= point.multiply_adds
+                            && other.flash <= point.flash;
+            bool better = other.skip_rate > point.skip_rate || other.multiply_adds < point.multiply_adds
+                          || other.flash < point.flash;
+            if (no_worse && better) {
+                point.pareto = false;
+                break;
+            }
+        }
+    }
+
+    printf("Hunit; Rate; Epochs; Precision; Threshold; Validation MAPE; Skip rate; MACs; Flash; Pareto\n");
+    for (const point_t & point : points) {
+        printf("%d; %g; %d; %d; %.3f; %.2f; %.2f; %ld; %ld; %d\n", point.trial->config.hunit,
+               point.trial->config.learning_rate, point.trial->best_epoch + 1, point.precision, point.threshold,
+               point.mape, point.skip_rate, point.multiply_adds, point.flash, point.pareto ? 1 : 0);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+//
+// Bounded lock free ring between one producer thread and one consumer thread.
+//
+
+#include <cstdlib>
+
+#include "spsc_ring.h"
+
+int spsc_ring_init(spsc_ring_t * ring, size_t capacity, size_t slot_bytes) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+    ring->slot_bytes = (slot_bytes + SPSC_RING_ALIGNMENT - 1) / SPSC_RING_ALIGNMENT * SPSC_RING_ALIGNMENT;
+    ring->mask = capacity - 1;
+    void * slots = NULL;
+    if (posix_memalign(&slots, SPSC_RING_ALIGNMENT, capacity * ring->slot_bytes) != 0) {
+        return -1;
+    }
+    ring->slots = (unsigned char *) slots;
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tail.store(0, std::memory_order_relaxed);
+    ring->cached_head = 0;
+    ring->cached_tail = 0;
+    return 0;
+}
+
+void spsc_ring_destroy(spsc_ring_t * ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+void * spsc_ring_acquire(spsc_ring_t * ring) {
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->cached_head > ring->mask) {
+        // Only read the consumer's line when the cached view says full
+        ring->cached_head = ring->head.load(std::memory_order_acquire);
+        if (tail - ring->cached_head > ring->mask) {
+            return NULL;
+        }
+    }
+    return ring->slots + (tail & ring->mask) * ring->slot_bytes;
+}
+
+void spsc_ring_publish(spsc_ring_t * ring) {
+    ring->tail.store(ring->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void * spsc_ring_peek(spsc_ring_t * ring) {
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    if (head == ring->cached_tail) {
+        ring->cached_tail = ring->tail.load(std::memory_order_acquire);
+        if (head == ring->cached_tail) {
+            return NULL;
+        }
+    }
+    return ring->slots + (head & ring->mask) * ring->slot_bytes;
+}
+
+void spsc_ring_release(spsc_ring_t * ring) {
+    ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
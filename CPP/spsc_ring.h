@@ -0,0 +1,60 @@
+//
+// Bounded lock free ring between one producer thread and one consumer thread.
+//
+// Slots have a fixed size and are used in place: the producer fills the slot returned by
+// spsc_ring_acquire and hands it over with spsc_ring_publish, the consumer reads the slot
+// returned by spsc_ring_peek and gives it back with spsc_ring_release, so batches are never
+// copied. A full ring is the backpressure: acquire returns NULL until the consumer catches up.
+//
+
+#ifndef CPP_SPSC_RING_H
+#define CPP_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Alignment of every slot, and distance between the fields each side writes
+#define SPSC_RING_ALIGNMENT 64
+
+struct spsc_ring_t {
+    unsigned char * slots;
+    size_t slot_bytes;                                      // rounded up to SPSC_RING_ALIGNMENT
+    size_t mask;                                            // capacity - 1
+
+    alignas(SPSC_RING_ALIGNMENT) std::atomic<size_t> head;  // next slot read, written by the consumer
+    size_t cached_tail;                                     // consumer's last view of tail
+
+    alignas(SPSC_RING_ALIGNMENT) std::atomic<size_t> tail;  // next slot written, written by the producer
+    size_t cached_head;                                     // producer's last view of head
+};
+
+/**
+ * capacity - number of slots, a power of two
+ * slot_bytes - size of one slot
+ * Returns 0, -1 on allocation failure or if capacity is not a power of two
+ */
+int spsc_ring_init(spsc_ring_t * ring, size_t capacity, size_t slot_bytes);
+
+void spsc_ring_destroy(spsc_ring_t * ring);
+
+/**
+ * Producer: next free slot, NULL when the ring is full
+ */
+void * spsc_ring_acquire(spsc_ring_t * ring);
+
+/**
+ * Producer: hands the slot returned by spsc_ring_acquire to the consumer
+ */
+void spsc_ring_publish(spsc_ring_t * ring);
+
+/**
+ * Consumer: oldest published slot, NULL when the ring is empty
+ */
+void * spsc_ring_peek(spsc_ring_t * ring);
+
+/**
+ * Consumer: gives the slot returned by spsc_ring_peek back to the producer
+ */
+void spsc_ring_release(spsc_ring_t * ring);
+
+#endif //CPP_SPSC_RING_H
@@ -0,0 +1,665 @@
+//
+// Staged streaming replay of the node's sample_tick() over a dataset export.
+//
+// stream_sim [-d dataset.csv] [-t threshold] [-x passes] [-r data rate] [-s | -p]
+//
+// The export is streamed through five stages linked by bounded lock free rings (spsc_ring.h):
+//   ingest  - reads the file in blocks of whole lines
+//   parse   - splits the lines into readings and gives every meter a device slot
+//   predict - dual prediction and transmission decision, the only loop carried state, each
+//             batch stepped as waves of distinct devices (device_store_predict)
+//   account - skip counters, uplink records and reconstruction error
+//   encode  - uplink frames per device, flushed like send_message() (uplink_batch.h)
+// -p runs every stage on its own thread, pinned to its own allowed core when there are enough, so
+// reading and parsing overlap inference and throughput is set by the slowest stage. -s runs
+// the same stages in turn on one thread. By default both run and their frames are compared.
+// -x streams the file several times, each pass as a new set of devices.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "conformance.h"
+#include "dataset.h"
+#include "device_store.h"
+#include "node_config.h"
+#include "node_sample.h"
+#include "parameters.h"
+#include "payload.h"
+#include "spsc_ring.h"
+#include "uplink_batch.h"
+
+#define STREAM_BLOCK_BYTES  65536
+#define STREAM_LINE_BYTES   512
+#define STREAM_BATCH        256
+#define STREAM_RING_SLOTS   16
+#define STREAM_STAGES       5
+
+struct text_block_t {
+    int pass;
+    int length;
+    bool last;
+    char data[STREAM_BLOCK_BYTES];
+};
+
+struct reading_t {
+    int device;
+    float measured;
+};
+
+struct decision_t {
+    int device;
+    float measured;
+    float value;                // reconstructed value the server holds
+    int32_t quantized;          // transmitted value
+    bool transmitted;
+};
+
+struct event_t {
+    int device;
+    uint32_t sequence;
+    bool transmitted;
+    uplink_t uplink;
+};
+
+template <typename T> struct batch_of_t {
+    int count;
+    bool last;
+    T items[STREAM_BATCH];
+};
+
+typedef batch_of_t<reading_t> reading_batch_t;
+typedef batch_of_t<decision_t> decision_batch_t;
+typedef batch_of_t<event_t> event_batch_t;
+
+struct stage_t {
+    const char * name;
+    bool finished;
+    long batches;
+    double busy_ms;
+};
+
+struct ingest_t {
+    stage_t stage;
+    FILE * file;
+    int passes;
+    int pass;
+    char carry[STREAM_LINE_BYTES];
+    int carry_length;
+    spsc_ring_t * output;
+};
+
+struct parse_t {
+    stage_t stage;
+    std::map<std::tuple<int, long long, int>, int> index;
+    long rows;
+    int cursor;                 // position in the current block
+    spsc_ring_t * input;
+    spsc_ring_t * output;
+};
+
+struct predict_t {
+    stage_t stage;
+    float threshold;
+    device_store_t store;               // slot of a device is its index
+    std::vector<uint32_t> wave_of;      // per device, last wave it was stepped in
+    uint32_t wave;
+    std::atomic<bool> * failed;         // set when a device cannot be added, stops every stage
+    spsc_ring_t * input;
+    spsc_ring_t * output;
+};
+
+struct account_t {
+    stage_t stage;
+    std::vector<uint32_t> sequence;     // next sample of each device
+    std::vector<uint32_t> skipped;
+    long samples;
+    long transmitted;
+    long errors;
+    double error_sum;
+    spsc_ring_t * input;
+    spsc_ring_t * output;
+};
+
+struct encode_t {
+    stage_t stage;
+    int max_payload;
+    std::vector<uplink_batch_t> batches;
+    std::vector<unsigned char> version_sent;
+    long frames;
+    long bytes;
+    uint32_t hash;
+    spsc_ring_t * input;
+};
+
+/**
+ * Reads the next block of whole lines, the rest of the last line is carried to the next block
+ */
+static bool ingest_poll(ingest_t * ingest) {
+    text_block_t * block = (text_block_t *) spsc_ring_acquire(ingest->output);
+    if (!block) {
+        return false;
+    }
+    memcpy(block->data, ingest->carry, ingest->carry_length);
+    int length = ingest->carry_length;
+    length += (int) fread(block->data + length, 1, STREAM_BLOCK_BYTES - length, ingest->file);
+
+    block->pass = ingest->pass;
+    block->last = false;
+    if (length < STREAM_BLOCK_BYTES) {
+        // End of the file, the block takes everything left
+        block->length = length;
+        ingest->carry_length = 0;
+        if (++ingest->pass < ingest->passes) {
+            rewind(ingest->file);
+        } else {
+            block->last = true;
+            ingest->stage.finished = true;
+        }
+    } else {
+        int end = length;
+        while (end > 0 && block->data[end - 1] != '\n') {
+            end--;
+        }
+        if (length - end > STREAM_LINE_BYTES || end == 0) {
+            end = length - STREAM_LINE_BYTES;    // not a dataset line anyway, cut it
+        }
+        block->length = end;
+        ingest->carry_length = length - end;
+        memcpy(ingest->carry, block->data + end, ingest->carry_length);
+    }
+    spsc_ring_publish(ingest->output);
+    return true;
+}
+
+/**
+ * Turns lines of the current block into one batch of readings, same parsing as dataset_load
+ */
+static bool parse_poll(parse_t * parse) {
+    text_block_t * block = (text_block_t *) spsc_ring_peek(parse->input);
+    if (!block) {
+        return false;
+    }
+    reading_batch_t * batch = (reading_batch_t *) spsc_ring_acquire(parse->output);
+    if (!batch) {
+        return false;
+    }
+
+    batch->count = 0;
+    while (parse->cursor < block->length && batch->count < STREAM_BATCH) {
+        char * line = block->data + parse->cursor;
+        char * end = (char *) memchr(line, '\n', block->length - parse->cursor);
+        if (!end) {
+            end = block->data + block->length;
+        }
+        parse->cursor = (int) (end - block->data) + 1;
+        *end = 0;
+
+        const char * fields[16];
+        int count = 0;
+        fields[count++] = line;
+        for (char * cursor = line; *cursor && count < 16; ++cursor) {
+            if (*cursor == ',') {
+                *cursor = 0;
+                fields[count++] = cursor + 1;
+            }
+        }
+        if (count <= DATASET_VALUE_COLUMN) {
+            continue;
+        }
+
+        std::tuple<int, long long, int> key(block->pass, atoll(fields[0]), atoi(fields[2]));
+        auto found = parse->index.find(key);
+        if (found == parse->index.end()) {
+            found = parse->index.emplace(key, (int) parse->index.size()).first;
+        }
+        reading_t * reading = &batch->items[batch->count++];
+        reading->device = found->second;
+        reading->measured = (float) atof(fields[DATASET_VALUE_COLUMN]);
+        parse->rows++;
+    }
+
+    bool block_done = parse->cursor >= block->length;
+    batch->last = block_done && block->last;
+    spsc_ring_publish(parse->output);
+    if (block_done) {
+        parse->cursor = 0;
+        parse->stage.finished = block->last;
+        spsc_ring_release(parse->input);
+    }
+    return true;
+}
+
+/**
+ * sample_tick() steps 1 to 4 and 7: forecast, decision and state update. Readings of the batch
+ * are taken in waves holding each device at most once, in arrival order, and every wave is
+ * forecast by one device_store_predict. Rows interleave meters, so a batch is mostly one wave.
+ */
+static bool predict_poll(predict_t * predict) {
+    reading_batch_t * input = (reading_batch_t *) spsc_ring_peek(predict->input);
+    if (!input) {
+        return false;
+    }
+    decision_batch_t * output = (decision_batch_t *) spsc_ring_acquire(predict->output);
+    if (!output) {
+        return false;
+    }
+    device_store_t * store = &predict->store;
+
+    int waiting[STREAM_BATCH];
+    int waiting_count = input->count;
+    for (int i = 0; i < input->count; ++i) {
+        waiting[i] = i;
+        while (input->items[i].device >= (int) store->count) {
+            if (device_store_add(store, std::to_string(store->count)) < 0) {
+                fprintf(stderr, "Cannot allocate the state of device %zu\n", store->count);
+                *predict->failed = true;
+                return false;
+            }
+            predict->wave_of.push_back(0);
+        }
+    }
+
+    while (waiting_count > 0) {
+        int wave[STREAM_BATCH];
+        int wave_count = 0;
+        int slots[STREAM_BATCH];
+        int slot_count = 0;
+        float forecasts[STREAM_BATCH];
+
+        // A later reading of a device already in the wave waits for the next one
+        predict->wave++;
+        int kept = 0;
+        for (int w = 0; w < waiting_count; ++w) {
+            int device = input->items[waiting[w]].device;
+            if (predict->wave_of[device] == predict->wave) {
+                waiting[kept++] = waiting[w];
+            } else {
+                predict->wave_of[device] = predict->wave;
+                wave[wave_count++] = waiting[w];
+                if (store->cold[device].started) {
+                    slots[slot_count++] = device;
+                }
+            }
+        }
+        waiting_count = kept;
+        device_store_predict(store, slots, slot_count, forecasts);
+
+        for (int w = 0, k = 0; w < wave_count; ++w) {
+            const reading_t & reading = input->items[wave[w]];
+            device_cold_t * device = &store->cold[reading.device];
+            bool first = !device->started;
+            node_sample_t sample;
+            node_sample_decide(&sample, first, reading.measured, first ? 0 : forecasts[k++], predict->threshold);
+
+            // node_sample_step without an uplink
+            if (first) {
+                device_store_restart(store, reading.device, sample.value, 0);
+                device->started = true;
+            } else if (sample.transmitted) {
+                device_store_correct(store, reading.device, sample.value);
+            } else {
+                device_store_commit(store, reading.device, sample.value);
+            }
+
+            decision_t * decision = &output->items[wave[w]];
+            decision->device = reading.device;
+            decision->measured = sample.measured;
+            decision->quantized = sample.quantized;
+            decision->value = sample.value;
+            decision->transmitted = sample.transmitted;
+        }
+    }
+    output->count = input->count;
+    output->last = input->last;
+    predict->stage.finished = input->last;
+    spsc_ring_publish(predict->output);
+    spsc_ring_release(predict->input);
+    return true;
+}
+
+/**
+ * sample_tick() steps 5 and 6: uplink record and skip counter of every decision
+ */
+static bool account_poll(account_t * account) {
+    decision_batch_t * input = (decision_batch_t *) spsc_ring_peek(account->input);
+    if (!input) {
+        return false;
+    }
+    event_batch_t * output = (event_batch_t *) spsc_ring_acquire(account->output);
+    if (!output) {
+        return false;
+    }
+
+    for (int i = 0; i < input->count; ++i) {
+        const decision_t & decision = input->items[i];
+        if (decision.device >= (int) account->sequence.size()) {
+            account->sequence.resize(decision.device + 1, 0);
+            account->skipped.resize(decision.device + 1, 0);
+        }
+        event_t * event = &output->items[i];
+        event->device = decision.device;
+        event->sequence = account->sequence[decision.device]++;
+        event->transmitted = decision.transmitted;
+
+        if (decision.transmitted) {
+            event->uplink.sequence = event->sequence;
+            event->uplink.skipped = account->skipped[decision.device];
+            event->uplink.value = decision.quantized;
+            event->uplink.model_version = MODEL_VERSION;
+            event->uplink.has_model_version = false;
+            account->skipped[decision.device] = 0;
+            account->transmitted++;
+        } else {
+            account->skipped[decision.device]++;
+        }
+        if (decision.measured != 0) {
+            account->error_sum += fabsf((decision.value - decision.measured) / decision.measured);
+            account->errors++;
+        }
+        account->samples++;
+    }
+    output->count = input->count;
+    output->last = input->last;
+    account->stage.finished = input->last;
+    spsc_ring_publish(account->output);
+    spsc_ring_release(account->input);
+    return true;
+}
+
+static void encode_flush(encode_t * encode, int device) {
+    uplink_batch_t * batch = &encode->batches[device];
+    if (batch->count == 0) {
+        return;
+    }
+    encode->hash = conformance_hash_bytes(encode->hash, batch->buffer, batch->length);
+    encode->frames++;
+    encode->bytes += batch->length;
+    encode->version_sent[device] = 1;
+    batch_reset(batch);
+}
+
+/**
+ * sample_tick() step 5 and send_message(): frames built and flushed as the node does,
+ * the radio always being free
+ */
+static bool encode_poll(encode_t * encode) {
+    event_batch_t * input = (event_batch_t *) spsc_ring_peek(encode->input);
+    if (!input) {
+        return false;
+    }
+
+    for (int i = 0; i < input->count; ++i) {
+        event_t * event = &input->items[i];
+        if (event->device >= (int) encode->batches.size()) {
+            size_t first = encode->batches.size();
+            encode->batches.resize(event->device + 1);
+            encode->version_sent.resize(event->device + 1, 0);
+            for (size_t device = first; device < encode->batches.size(); ++device) {
+                batch_reset(&encode->batches[device]);
+            }
+        }
+        uplink_batch_t * batch = &encode->batches[event->device];
+        if (event->transmitted) {
+            event->uplink.has_model_version = !encode->version_sent[event->device];
+            if (batch_add(batch, &event->uplink, encode->max_payload) < 0) {
+                encode_flush(encode, event->device);
+                batch_add(batch, &event->uplink, encode->max_payload);
+            }
+        }
+        if (batch_due(batch, event->sequence + 1, BATCH_MAX_LATENCY, encode->max_payload)) {
+            encode_flush(encode, event->device);
+        }
+    }
+    if (input->last) {
+        for (size_t device = 0; device < encode->batches.size(); ++device) {
+            encode_flush(encode, (int) device);
+        }
+        encode->stage.finished = true;
+    }
+    spsc_ring_release(encode->input);
+    return true;
+}
+
+struct stream_t {
+    spsc_ring_t rings[STREAM_STAGES - 1];
+    std::atomic<bool> failed;
+    ingest_t ingest;
+    parse_t parse;
+    predict_t predict;
+    account_t account;
+    encode_t encode;
+};
+
+/**
+ * Runs one poll of a stage and accounts its time when it did something
+ */
+static bool poll(stream_t * stream, int stage) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool progress = false;
+    stage_t * state = NULL;
+    switch (stage) {
+        case 0: state = &stream->ingest.stage; progress = !state->finished && ingest_poll(&stream->ingest); break;
+        case 1: state = &stream->parse.stage; progress = !state->finished && parse_poll(&stream->parse); break;
+        case 2: state = &stream->predict.stage; progress = !state->finished && predict_poll(&stream->predict); break;
+        case 3: state = &stream->account.stage; progress = !state->finished && account_poll(&stream->account); break;
+        default: state = &stream->encode.stage; progress = !state->finished && encode_poll(&stream->encode); break;
+    }
+    if (progress) {
+        state->batches++;
+        state->busy_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    return progress;
+}
+
+static stage_t * stage_of(stream_t * stream, int stage) {
+    stage_t * stages[STREAM_STAGES] = {&stream->ingest.stage, &stream->parse.stage, &stream->predict.stage,
+                                       &stream->account.stage, &stream->encode.stage};
+    return stages[stage];
+}
+
+static void stage_thread(stream_t * stream, int stage) {
+    while (!stage_of(stream, stage)->finished && !stream->failed) {
+        if (!poll(stream, stage)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/**
+ * CPUs of the process affinity mask (taskset, cpuset), in order
+ */
+static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+/**
+ * Streams the file once through the stages, on one thread or one thread per stage
+ * Returns 0, -1 if the file cannot be opened, the rings allocated or a device state allocated
+ */
+static int run(stream_t * stream, const char * path, int passes, float threshold, int max_payload, bool threaded,
+               double * elapsed_ms, int * pinned) {
+    FILE * file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open dataset %s\n", path);
+        return -1;
+    }
+    const size_t slot_bytes[STREAM_STAGES - 1] = {sizeof(text_block_t), sizeof(reading_batch_t),
+                                                  sizeof(decision_batch_t), sizeof(event_batch_t)};
+    for (int i = 0; i < STREAM_STAGES - 1; ++i) {
+        if (spsc_ring_init(&stream->rings[i], STREAM_RING_SLOTS, slot_bytes[i]) < 0) {
+            fclose(file);
+            return -1;
+        }
+    }
+
+    stream->ingest.stage = {"ingest", false, 0, 0};
+    stream->ingest.file = file;
+    stream->ingest.passes = passes;
+    stream->ingest.pass = 0;
+    stream->ingest.carry_length = 0;
+    stream->ingest.output = &stream->rings[0];
+
+    stream->parse.stage = {"parse", false, 0, 0};
+    stream->parse.index.clear();
+    stream->parse.rows = 0;
+    stream->parse.cursor = 0;
+    stream->parse.input = &stream->rings[0];
+    stream->parse.output = &stream->rings[1];
+
+    stream->predict.stage = {"predict", false, 0, 0};
+    stream->predict.threshold = threshold;
+    device_store_init(&stream->predict.store);
+    stream->predict.wave_of.clear();
+    stream->predict.wave = 0;
+    stream->predict.failed = &stream->failed;
+    stream->failed = false;
+    stream->predict.input = &stream->rings[1];
+    stream->predict.output = &stream->rings[2];
+
+    stream->account.stage = {"account", false, 0, 0};
+    stream->account.sequence.clear();
+    stream->account.skipped.clear();
+    stream->account.samples = 0;
+    stream->account.transmitted = 0;
+    stream->account.errors = 0;
+    stream->account.error_sum = 0;
+    stream->account.input = &stream->rings[2];
+    stream->account.output = &stream->rings[3];
+
+    stream->encode.stage = {"encode", false, 0, 0};
+    stream->encode.max_payload = max_payload;
+    stream->encode.batches.clear();
+    stream->encode.version_sent.clear();
+    stream->encode.frames = 0;
+    stream->encode.bytes = 0;
+    stream->encode.hash = CONFORMANCE_HASH_SEED;
+    stream->encode.input = &stream->rings[3];
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    *pinned = 0;
+    if (threaded) {
+        std::vector<int> cpus = allowed_cpus();
+        std::vector<std::thread> threads;
+        for (int stage = 0; stage < STREAM_STAGES; ++stage) {
+            threads.push_back(std::thread(stage_thread, stream, stage));
+            if (cpus.size() >= STREAM_STAGES) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpus[stage], &set);
+                *pinned += pthread_setaffinity_np(threads.back().native_handle(), sizeof(set), &set) == 0;
+            }
+        }
+        for (std::thread & thread : threads) {
+            thread.join();
+        }
+    } else {
+        while (!stream->encode.stage.finished && !stream->failed) {
+            for (int stage = 0; stage < STREAM_STAGES; ++stage) {
+                poll(stream, stage);
+            }
+        }
+    }
+    *elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    fclose(file);
+    for (int i = 0; i < STREAM_STAGES - 1; ++i) {
+        spsc_ring_destroy(&stream->rings[i]);
+    }
+    device_store_free(&stream->predict.store);
+    return stream->failed ? -1 : 0;
+}
+
+static void report(stream_t * stream, bool threaded, double elapsed_ms, int pinned) {
+    printf("%s: %ld readings of %zu devices in %.1f ms, %.2f M readings/s",
+           threaded ? "Pipelined" : "Serial", stream->parse.rows, stream->parse.index.size(), elapsed_ms,
+           elapsed_ms > 0 ? stream->parse.rows / elapsed_ms / 1000.0 : 0.0);
+    printf(threaded ? ", %d of %d stages pinned\n" : "\n", pinned, STREAM_STAGES);
+    printf("  Stage; Batches; Busy ms\n");
+    for (int stage = 0; stage < STREAM_STAGES; ++stage) {
+        stage_t * state = stage_of(stream, stage);
+        printf("  %s; %ld; %.1f\n", state->name, state->batches, state->busy_ms);
+    }
+    printf("  %ld of %ld transmitted (%.2f%%), mean error %.4f, %ld frames, %ld bytes, frames hash %08lx\n",
+           stream->account.transmitted, stream->account.samples,
+           stream->account.samples ? 100.0 * stream->account.transmitted / stream->account.samples : 0.0,
+           stream->account.errors ? stream->account.error_sum / stream->account.errors : 0.0,
+           stream->encode.frames, stream->encode.bytes, (unsigned long) stream->encode.hash);
+}
+
+int main(int argc, char ** argv) {
+    const char * path = "../Python/dataset.csv";
+    float threshold = 0.3f;
+    int passes = 1;
+    int data_rate = 0;
+    bool serial = true;
+    bool pipelined = true;
+
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "-s")) {
+            pipelined = false;
+        } else if (!strcmp(argv[i], "-p")) {
+            serial = false;
+        } else if (!strcmp(argv[i], "-d") && has_value) {
+            path = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && has_value) {
+            threshold = (float) atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-x") && has_value) {
+            passes = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && has_value) {
+            data_rate = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: stream_sim [-d dataset.csv] [-t threshold] [-x passes] [-r data rate] [-s | -p]\n");
+            return 1;
+        }
+    }
+    if (passes < 1 || !(serial || pipelined)) {
+        fprintf(stderr, "Nothing to run\n");
+        return 1;
+    }
+
+    // Static storage keeps the cache line alignment of the rings
+    static stream_t stream_storage;
+    stream_t * stream = &stream_storage;
+    uint32_t hashes[2];
+    int runs = 0;
+    for (int threaded = 0; threaded < 2; ++threaded) {
+        if (!(threaded ? pipelined : serial)) {
+            continue;
+        }
+        double elapsed_ms;
+        int pinned;
+        if (run(stream, path, passes, threshold, eu868_max_payload(data_rate), threaded, &elapsed_ms, &pinned) < 0) {
+            return 1;
+        }
+        report(stream, threaded, elapsed_ms, pinned);
+        hashes[runs++] = stream->encode.hash;
+    }
+
+    if (runs == 2 && hashes[0] != hashes[1]) {
+        printf("Serial and pipelined frames differ\n");
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+//
+// Offline evaluation of transmission threshold policies over dataset.csv.
+//
+// threshold_sim [dataset.csv] [minimum samples per meter]
+//
+// Replays the node's sample_tick() logic on every meter for each policy and reports the
+// fraction of samples transmitted, transmissions per meter and day, and the reconstruction
+// error the server ends up with. Build with ANOMALY_GATE or ONLINE_DENSE to compare them.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "dataset.h"
+#include "dual_prediction.h"
+#include "node_sample.h"
+#include "threshold.h"
+
+struct policy_t {
+    const char * name;
+    threshold_mode_t mode;
+    float initial;
+    float target;
+};
+
+struct outcome_t {
+    long transmitted;
+    long total;
+    double days;                // meter-days replayed
+    long gated;                 // corrections gated as outliers (ANOMALY_GATE)
+    std::vector<float> errors;  // relative reconstruction error of every sample
+};
+
+static void replay(const meter_series_t & meter, const policy_t & policy, outcome_t * outcome) {
+    dual_prediction_t prediction;
+    threshold_controller_t controller;
+    threshold_init(&controller, policy.mode, policy.initial, policy.target);
+
+    for (size_t i = 0; i < meter.values.size(); ++i) {
+        float measured = meter.values[i];
+        node_sample_t sample;
+        node_sample_step(&prediction, (uint32_t) i, measured, controller.threshold, NULL, &sample);
+        if (i > 0) {
+            threshold_update(&controller, sample.error, sample.transmitted);
+        }
+
+        outcome->transmitted += sample.transmitted;
+        if (measured != 0) {
+            outcome->errors.push_back(fabsf((sample.value - measured) / measured));
+        }
+        outcome->total++;
+    }
+    outcome->days += (meter.timestamps.back() - meter.timestamps.front()) / 86400000.0;
+#ifdef ANOMALY_GATE
+    outcome->gated += prediction.gated;
+#endif
+}
+
+int main(int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "../Python/dataset.csv";
+    size_t minimum = argc > 2 ? (size_t) atoi(argv[2]) : 100;
+
+    std::vector<meter_series_t> meters;
+    if (dataset_load(path, DATASET_VALUE_COLUMN, &meters) < 0) {
+        return 1;
+    }
+
+    const policy_t policies[] = {
+        {"fixed", THRESHOLD_FIXED, 0.05f, 0},
+        {"fixed", THRESHOLD_FIXED, 0.1f, 0},
+        {"fixed", THRESHOLD_FIXED, 0.3f, 0},
+        {"fixed", THRESHOLD_FIXED, 0.5f, 0},
+        {"budget", THRESHOLD_BUDGET, 0.3f, 0.1f},
+        {"budget", THRESHOLD_BUDGET, 0.3f, 0.2f},
+        {"budget", THRESHOLD_BUDGET, 0.3f, 0.4f},
+        {"error", THRESHOLD_ERROR, 0.3f, 0.05f},
+        {"error", THRESHOLD_ERROR, 0.3f, 0.1f},
+        {"error", THRESHOLD_ERROR, 0.3f, 0.2f},
+    };
+
+    printf("Policy; Target; Count; Total; Proportion; Per day; Gated; Mean error; P95 error\n");
+    for (const policy_t & policy : policies) {
+        outcome_t outcome = {0, 0, 0, 0, std::vector<float>()};
+        for (const meter_series_t & meter : meters) {
+            if (meter.values.size() >= minimum) {
+                replay(meter, policy, &outcome);
+            }
+        }
+
+        double mean = 0;
+        for (float error : outcome.errors) {
+            mean += error;
+        }
+        mean = outcome.errors.empty() ? 0 : mean / outcome.errors.size();
+        float p95 = 0;
+        if (!outcome.errors.empty()) {
+            size_t rank = outcome.errors.size() * 95 / 100;
+            std::nth_element(outcome.errors.begin(), outcome.errors.begin() + rank, outcome.errors.end());
+            p95 = outcome.errors[rank];
+        }
+
+        printf("%s; %.3f; %ld; %ld; %.2f; %.1f; %ld; %.4f; %.4f\n", policy.name,
+               policy.mode == THRESHOLD_FIXED ? policy.initial : policy.target,
+               outcome.transmitted, outcome.total,
+               outcome.total ? 100.0 * outcome.transmitted / outcome.total : 0.0,
+               outcome.days > 0 ? outcome.transmitted / outcome.days : 0.0, outcome.gated, mean, p95);
+    }
+    return 0;
+}
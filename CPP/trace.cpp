@@ -0,0 +1,239 @@
+//
+// Per step traces of a dual prediction replay, recorded from one kernel and compared against another.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "conformance.h"
+#include "node_sample.h"
+#include "trace.h"
+
+#define TRACE_MAGIC   0x4354524cu   // "LTRC"
+#define TRACE_VERSION 1
+
+int trace_record(const trace_kernel_t * kernel, const float * series, int length, float threshold,
+                 const trace_t * forced, trace_t * trace) {
+    if (forced && forced->length != length) {
+        return -1;
+    }
+    const lstm_model_t * model = kernel->model;
+    const int hunit = model->hunit;
+
+    trace->hunit = hunit;
+    trace->threshold = threshold;
+    trace->length = length;
+    trace->measured.assign(series, series + length);
+    trace->diff.assign(length, 0);
+    trace->delta.assign(length, 0);
+    trace->forecast.assign(length, 0);
+    trace->reconstructed.assign(length, 0);
+    trace->sent.assign(length, 0);
+    trace->hidden_layer.assign((size_t) length * hunit, 0);
+    trace->cell_states.assign((size_t) length * hunit, 0);
+
+    float hidden_layer[MODEL_MAX_HUNIT];
+    float cell_states[MODEL_MAX_HUNIT];
+    memcpy(hidden_layer, model->hidden_layer.data(), hunit * sizeof(float));
+    memcpy(cell_states, model->cell_states.data(), hunit * sizeof(float));
+
+    float previous = 0;
+    float previous_diff = 0;
+    for (int i = 0; i < length; ++i) {
+        float forecast = 0;
+        float y_diff = 0;
+
+        if (i > 0) {
+            if (forced) {
+                previous_diff = forced->diff[i];
+                previous = forced->reconstructed[i - 1];
+            }
+            float input = model->scaler_folded ? previous_diff : scale_value(&model->scaler, previous_diff);
+            float output = kernel->step(model, kernel->context, input, hidden_layer, cell_states);
+            y_diff = model->scaler_folded ? output : invert_scale_value(&model->scaler, output);
+            // Same order as invert_difference
+            forecast = y_diff + previous;
+        }
+
+        node_sample_t sample;
+        node_sample_decide(&sample, i == 0, series[i], forecast, threshold);
+        trace->diff[i] = i > 0 ? previous_diff : 0;
+        trace->delta[i] = y_diff;
+        trace->forecast[i] = sample.forecast;
+        trace->reconstructed[i] = sample.value;
+        trace->sent[i] = sample.transmitted ? 1 : 0;
+        memcpy(&trace->hidden_layer[(size_t) i * hunit], hidden_layer, hunit * sizeof(float));
+        memcpy(&trace->cell_states[(size_t) i * hunit], cell_states, hunit * sizeof(float));
+
+        previous_diff = i > 0 ? sample.value - previous : 0;
+        previous = sample.value;
+    }
+    return 0;
+}
+
+uint32_t trace_hash(const trace_t * trace) {
+    uint32_t hash = CONFORMANCE_HASH_SEED;
+    for (int i = 0; i < trace->length; ++i) {
+        if (i > 0) {
+            hash = conformance_hash_float(hash, trace->forecast[i]);
+        }
+        hash = conformance_hash_float(hash, trace->reconstructed[i]);
+    }
+    return hash;
+}
+
+/**
+ * Every per step array of a trace, in file order
+ */
+static int trace_arrays(trace_t * trace, std::vector<float> ** arrays) {
+    int count = 0;
+    arrays[count++] = &trace->measured;
+    arrays[count++] = &trace->diff;
+    arrays[count++] = &trace->delta;
+    arrays[count++] = &trace->forecast;
+    arrays[count++] = &trace->reconstructed;
+    arrays[count++] = &trace->hidden_layer;
+    arrays[count++] = &trace->cell_states;
+    return count;
+}
+
+int trace_save(const trace_t * trace, const char * path) {
+    FILE * file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return -1;
+    }
+    uint32_t header[3] = {TRACE_MAGIC, TRACE_VERSION, 0};
+    int32_t shape[2] = {trace->hunit, trace->length};
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1
+              && fwrite(shape, sizeof(shape), 1, file) == 1
+              && fwrite(&trace->threshold, sizeof(float), 1, file) == 1;
+
+    std::vector<float> * arrays[8];
+    int count = trace_arrays(const_cast<trace_t *>(trace), arrays);
+    for (int a = 0; ok && a < count; ++a) {
+        ok = fwrite(arrays[a]->data(), sizeof(float), arrays[a]->size(), file) == arrays[a]->size();
+    }
+    ok = ok && fwrite(trace->sent.data(), 1, trace->sent.size(), file) == trace->sent.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int trace_load(trace_t * trace, const char * path) {
+    FILE * file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return -1;
+    }
+    uint32_t header[3];
+    int32_t shape[2];
+    bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == TRACE_MAGIC
+              && header[1] == TRACE_VERSION
+              && fread(shape, sizeof(shape), 1, file) == 1
+              && shape[0] > 0 && shape[0] <= MODEL_MAX_HUNIT && shape[1] >= 0
+              && fread(&trace->threshold, sizeof(float), 1, file) == 1;
+    if (ok) {
+        trace->hunit = shape[0];
+        trace->length = shape[1];
+        std::vector<float> * arrays[8];
+        int count = trace_arrays(trace, arrays);
+        for (int a = 0; a < count; ++a) {
+            bool state = arrays[a] == &trace->hidden_layer || arrays[a] == &trace->cell_states;
+            arrays[a]->resize((size_t) trace->length * (state ? trace->hunit : 1));
+            ok = ok && fread(arrays[a]->data(), sizeof(float), arrays[a]->size(), file) == arrays[a]->size();
+        }
+        trace->sent.resize(trace->length);
+        ok = ok && fread(trace->sent.data(), 1, trace->sent.size(), file) == trace->sent.size();
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s is not a trace\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+const char * trace_field_name(int field) {
+    static const char * names[TRACE_FIELDS] = {"delta", "forecast", "reconstructed", "hidden", "cell"};
+    return field >= 0 && field < TRACE_FIELDS ? names[field] : "?";
+}
+
+int trace_compare(const trace_t * reference, const trace_t * value, double absolute, double relative,
+                  int window, trace_report_t * report) {
+    if (reference->length != value->length || reference->measured != value->measured || window < 1) {
+        return -1;
+    }
+    const int length = reference->length;
+    const int hunit = reference->hunit;
+
+    report->steps = length;
+    report->states = reference->hunit == value->hunit;
+    for (int f = 0; f < TRACE_FIELDS; ++f) {
+        report->errors[f] = {0, 0, -1};
+    }
+    report->first = {-1, 0, 0, 0, 0};
+    report->divergent = 0;
+    report->decision_first = -1;
+    report->decisions = 0;
+    report->reference_sent = 0;
+    report->sent = 0;
+    report->window = window;
+    report->windows.assign((size_t) (length + window - 1) / window * TRACE_FIELDS, {0, 0, -1});
+
+    for (int i = 0; i < length; ++i) {
+        const float * references[TRACE_FIELDS] = {
+                &reference->delta[i], &reference->forecast[i], &reference->reconstructed[i],
+                &reference->hidden_layer[(size_t) i * hunit], &reference->cell_states[(size_t) i * hunit]};
+        const float * values[TRACE_FIELDS] = {
+                &value->delta[i], &value->forecast[i], &value->reconstructed[i],
+                report->states ? &value->hidden_layer[(size_t) i * hunit] : NULL,
+                report->states ? &value->cell_states[(size_t) i * hunit] : NULL};
+        trace_error_t * windowed = &report->windows[(size_t) (i / window) * TRACE_FIELDS];
+        bool divergent = false;
+
+        for (int f = 0; f < TRACE_FIELDS; ++f) {
+            if (!values[f]) {
+                continue;
+            }
+            int components = f == TRACE_HIDDEN || f == TRACE_CELL ? hunit : 1;
+            for (int k = 0; k < components; ++k) {
+                float expected = references[f][k];
+                float got = values[f][k];
+                double error = fabs((double) got - (double) expected);
+                // Written so that NaN is out of tolerance
+                bool within = error <= absolute + relative * fabs((double) expected);
+
+                trace_error_t * errors[2] = {&report->errors[f], &windowed[f]};
+                for (trace_error_t * e : errors) {
+                    if (error > e->max) {
+                        e->max = error;
+                        e->at = i;
+                    }
+                    e->sum += error;
+                }
+                if (!within) {
+                    divergent = true;
+                    if (report->first.step < 0) {
+                        report->first = {i, f, k, expected, got};
+                    }
+                }
+            }
+        }
+        report->divergent += divergent;
+
+        report->reference_sent += reference->sent[i];
+        report->sent += value->sent[i];
+        if (reference->sent[i] != value->sent[i]) {
+            if (report->decision_first < 0) {
+                report->decision_first = i;
+            }
+            report->decisions++;
+        }
+    }
+    return 0;
+}
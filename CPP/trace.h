@@ -0,0 +1,125 @@
+//
+// Per step traces of a dual prediction replay, recorded from one kernel and compared against another.
+//
+// A trace keeps, for every sample, what went into the model (the reconstructed difference),
+// the state it left behind (h, c), what came out (forecast delta, forecast), the transmission
+// decision and the reconstructed value. A reference trace recorded once with the exact kernel
+// can then be compared with any other kernel (unrolled, vectorised, quantized, approximate
+// activations, a re-exported model) within a tolerance, reporting the first divergence and how
+// the error grows along the series.
+//
+// Replays here run the plain dual prediction of conformance_replay (fixed dense head, no
+// outlier gate), the kernel being what is under test.
+//
+
+#ifndef CPP_TRACE_H
+#define CPP_TRACE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "model.h"
+
+/**
+ * A kernel under test: one LSTM step plus the dense head, on the caller's h and c
+ * model - hunit, scaler and initial state of the kernel
+ * Returns the dense output, in model space (scaled unless the scaler is folded)
+ */
+struct trace_kernel_t {
+    const char * name;
+    const lstm_model_t * model;
+    void * context;
+    float (*step)(const lstm_model_t * model, void * context, float input, float * hidden_layer,
+                  float * cell_states);
+};
+
+struct trace_t {
+    int hunit;
+    float threshold;
+    int length;
+    std::vector<float> measured;
+    std::vector<float> diff;            // raw difference fed to the model, 0 on the first sample
+    std::vector<float> delta;           // raw forecast difference, 0 on the first sample
+    std::vector<float> forecast;        // the measured value on the first sample
+    std::vector<float> reconstructed;
+    std::vector<unsigned char> sent;
+    std::vector<float> hidden_layer;    // [length][hunit], after the step
+    std::vector<float> cell_states;     // [length][hunit]
+};
+
+/**
+ * Replays series through kernel and records every step
+ * forced - optional reference trace to follow: the model is fed the reference's reconstructed
+ *   differences and forecasts from the reference's last reconstructed value, so decisions of
+ *   the kernel never change what it sees next and only its own state carries error forward.
+ *   Without it the kernel runs closed loop, as a node would.
+ * Returns 0, -1 if forced was recorded over another series length
+ */
+int trace_record(const trace_kernel_t * kernel, const float * series, int length, float threshold,
+                 const trace_t * forced, trace_t * trace);
+
+/**
+ * FNV-1a of the forecasts and reconstructed values, as conformance_replay hashes them
+ */
+uint32_t trace_hash(const trace_t * trace);
+
+/**
+ * Returns 0, -1 on I/O error
+ */
+int trace_save(const trace_t * trace, const char * path);
+
+/**
+ * Returns 0, -1 if the file cannot be read or is not a trace
+ */
+int trace_load(trace_t * trace, const char * path);
+
+// Fields compared, h and c only when both traces have the same hunit
+enum trace_field_t {
+    TRACE_DELTA,
+    TRACE_FORECAST,
+    TRACE_RECONSTRUCTED,
+    TRACE_HIDDEN,
+    TRACE_CELL,
+    TRACE_FIELDS
+};
+
+const char * trace_field_name(int field);
+
+struct trace_error_t {
+    double max;                         // absolute error
+    double sum;
+    int at;                             // step of max, -1 if never different
+};
+
+struct trace_divergence_t {
+    int step;                           // -1 if none
+    int field;
+    int component;                      // unit of h or c, 0 otherwise
+    float reference;
+    float value;
+};
+
+struct trace_report_t {
+    int steps;
+    bool states;                        // h and c were compared
+    trace_error_t errors[TRACE_FIELDS];
+    trace_divergence_t first;           // first value out of tolerance
+    int divergent;                      // steps with a value out of tolerance
+    int decision_first;                 // first step with another transmission decision, -1 if none
+    int decisions;                      // steps with another transmission decision
+    int reference_sent;
+    int sent;
+    int window;                         // steps per window
+    std::vector<trace_error_t> windows; // [windows][TRACE_FIELDS], error of each field per window
+};
+
+/**
+ * Compares value to reference field by field. A value is out of tolerance when
+ * |value - reference| > absolute + relative * |reference|, NaN always is.
+ * window - steps per entry of report->windows
+ * Returns 0, -1 if the traces do not cover the same series or window < 1
+ */
+int trace_compare(const trace_t * reference, const trace_t * value, double absolute, double relative,
+                  int window, trace_report_t * report);
+
+#endif //CPP_TRACE_H
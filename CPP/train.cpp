@@ -0,0 +1,148 @@
+//
+// Trains one model per hidden layer size, in parallel, and writes them as parameters.N.h.
+//
+// train [-d dataset.csv] [-c country] [-e epochs] [-w window] [-r rate] [-s seed] [-j threads]
+//       [-v model version] output_directory hunit...
+//
+// The meter series (the longest one unless -c picks a country code) is split as in the
+// notebooks: the last third is held out and only used for the reported validation MAPE.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dataset.h"
+#include "trainer.h"
+
+struct job_t {
+    train_config_t config;
+    lstm_model_t model;
+    float loss;
+    float mape;
+    double seconds;
+};
+
+struct pool_t {
+    std::vector<job_t> * jobs;
+    std::atomic<size_t> next;
+    const std::vector<float> * series;
+    int train_length;
+};
+
+static void worker(pool_t * pool) {
+    for (;;) {
+        size_t index = pool->next++;
+        if (index >= pool->jobs->size()) {
+            return;
+        }
+        job_t & job = (*pool->jobs)[index];
+        const std::vector<float> & series = *pool->series;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        job.loss = train_lstm(&job.config, series.data(), pool->train_length, &job.model, NULL, NULL);
+        job.mape = job.loss < 0 ? -1 : model_mape(&job.model, series.data(), (int) series.size(), pool->train_length);
+        job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char ** argv) {
+    const char * path = "../Python/dataset.csv";
+    int country = -1;
+    train_config_t config = {0, 32, 20, 0.001f, 1};
+    int threads = (int) std::thread::hardware_concurrency();
+    int version = 1;
+    const char * output = NULL;
+    std::vector<int> hunits;
+
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-' && argv[i][1] && !argv[i][2] && i + 1 < argc) {
+            const char * value = argv[++i];
+            switch (argv[i - 1][1]) {
+                case 'd': path = value; break;
+                case 'c': country = atoi(value); break;
+                case 'e': config.epochs = atoi(value); break;
+                case 'w': config.window = atoi(value); break;
+                case 'r': config.learning_rate = (float) atof(value); break;
+                case 's': config.seed = (unsigned int) strtoul(value, NULL, 10); break;
+                case 'j': threads = atoi(value); break;
+                case 'v': version = atoi(value); break;
+                default:
+                    fprintf(stderr, "Unknown option %s\n", argv[i - 1]);
+                    return 1;
+            }
+        } else if (!output) {
+            output = argv[i];
+        } else {
+            hunits.push_back(atoi(argv[i]));
+        }
+    }
+    if (!output || hunits.empty()) {
+        fprintf(stderr, "usage: train [-d dataset.csv] [-c country] [-e epochs] [-w window] [-r rate] "
+                        "[-s seed] [-j threads] [-v model version] output_directory hunit...\n");
+        return 1;
+    }
+
+    std::vector<meter_series_t> meters;
+    if (dataset_load(path, DATASET_VALUE_COLUMN, &meters) < 0) {
+        return 1;
+    }
+    const meter_series_t * meter = NULL;
+    for (const meter_series_t & candidate : meters) {
+        if (country >= 0 ? candidate.country == country
+                         : !meter || candidate.values.size() > meter->values.size()) {
+            meter = &candidate;
+        }
+    }
+    if (!meter) {
+        fprintf(stderr, "No meter for country %d\n", country);
+        return 1;
+    }
+
+    int length = (int) meter->values.size();
+    pool_t pool;
+    std::vector<job_t> jobs(hunits.size());
+    pool.jobs = &jobs;
+    pool.next = 0;
+    pool.series = &meter->values;
+    pool.train_length = length - length / 3;
+    for (size_t i = 0; i < hunits.size(); ++i) {
+        jobs[i].config = config;
+        jobs[i].config.hunit = hunits[i];
+    }
+
+    fprintf(stderr, "Training %zu models on square %lld country %d, %d samples (%d held out)\n",
+            jobs.size(), meter->square, meter->country, length, length - pool.train_length);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < (threads > 1 ? threads : 1) && i < (int) jobs.size(); ++i) {
+        workers.push_back(std::thread(worker, &pool));
+    }
+    for (std::thread & thread : workers) {
+        thread.join();
+    }
+
+    int status = 0;
+    printf("HUNIT; Epochs; Window; Rate; Train MSE; Validation MAPE; Seconds\n");
+    for (job_t & job : jobs) {
+        if (job.loss < 0) {
+            fprintf(stderr, "Invalid configuration HUNIT %d\n", job.config.hunit);
+            status = 1;
+            continue;
+        }
+        printf("%d; %d; %d; %g; %.6f; %.2f; %.2f\n", job.config.hunit, job.config.epochs, job.config.window,
+               job.config.learning_rate, job.loss, job.mape, job.seconds);
+
+        job.model.version = version;
+        std::string file = std::string(output) + "/parameters." + std::to_string(job.config.hunit) + ".h";
+        if (model_save(&job.model, file.c_str()) < 0) {
+            status = 1;
+        }
+    }
+    return status;
+}
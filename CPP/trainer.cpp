@@ -0,0 +1,291 @@
+//
+// Truncated BPTT trainer for the LSTM + dense architecture of handmade.cpp.
+//
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "deterministic.h"
+#include "handmade.h"
+#include "pipeline.h"
+#include "trainer.h"
+
+// Adam constants, Keras defaults
+#define ADAM_BETA1 0.9f
+#define ADAM_BETA2 0.999f
+#define ADAM_EPSILON 1e-7f
+
+struct adam_t {
+    std::vector<float> m;
+    std::vector<float> v;
+};
+
+// Activations of one window, t = 0 is the state the window starts from
+struct window_t {
+    std::vector<float> input;           // window
+    std::vector<float> target;          // window
+    std::vector<float> gates;           // window * 4*hunit - i, f, c, o after the sigmoid
+    std::vector<float> hidden_layer;    // (window + 1) * hunit
+    std::vector<float> cell_states;     // (window + 1) * hunit
+    std::vector<float> output;          // window
+};
+
+/**
+ * xorshift32, same sequence on every platform so that a seed names a model
+ */
+static float random_uniform(unsigned int * state, float limit) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return limit * (2.0f * (float) (x >> 8) / 16777216.0f - 1.0f);
+}
+
+/**
+ * Glorot uniform weights, zero biases except the forget gate at 1 (Keras unit_forget_bias).
+ * The recurrent matrix uses Glorot uniform as well rather than Keras' orthogonal init.
+ */
+static void init_model(lstm_model_t * model, int hunit, unsigned int seed) {
+    unsigned int state = seed ? seed : 1;
+
+    model->hunit = hunit;
+    model->version = 1;
+    model->scaler_folded = false;
+
+    model->input_weights.resize(4 * hunit);
+    float limit = sqrtf(6.0f / (1 + 4 * hunit));
+    for (float & weight : model->input_weights) {
+        weight = random_uniform(&state, limit);
+    }
+
+    model->hidden_weights.resize(4 * hunit * hunit);
+    limit = sqrtf(6.0f / (hunit + 4 * hunit));
+    for (float & weight : model->hidden_weights) {
+        weight = random_uniform(&state, limit);
+    }
+
+    model->bias.assign(4 * hunit, 0.0f);
+    for (int i = 0; i < hunit; ++i) {
+        model->bias[1 * hunit + i] = 1.0f;
+    }
+
+    model->hidden_layer.assign(hunit, 0.0f);
+    model->cell_states.assign(hunit, 0.0f);
+
+    model->dense_weights.resize(hunit);
+    limit = sqrtf(6.0f / (hunit + 1));
+    for (float & weight : model->dense_weights) {
+        weight = random_uniform(&state, limit);
+    }
+    model->dense_bias = 0;
+}
+
+/**
+ * Same expressions in the same order as lstmCellSimple and dense_nn, keeping the gates
+ */
+static float forward(const lstm_model_t * model, window_t * window, int length) {
+    const int hunit = model->hunit;
+    float loss = 0;
+
+    for (int t = 0; t < length; ++t) {
+        const float input = window->input[t];
+        const float * hidden_layer = &window->hidden_layer[t * hunit];
+        const float * cell_states = &window->cell_states[t * hunit];
+        float * gates = &window->gates[t * 4 * hunit];
+        float * new_hidden_layer = &window->hidden_layer[(t + 1) * hunit];
+        float * new_cell_states = &window->cell_states[(t + 1) * hunit];
+
+        for (int k = 0; k < 4; ++k) {
+            for (int i = 0; i < hunit; ++i) {
+                float gate = model->input_weights[k * hunit + i] * input;
+                for (int j = 0; j < hunit; ++j) {
+                    gate += model->hidden_weights[(k * hunit + i) * hunit + j] * hidden_layer[j];
+                }
+                gate += model->bias[k * hunit + i];
+                gates[k * hunit + i] = sigmoid_function(gate);
+            }
+        }
+
+        float output = 0;
+        for (int i = 0; i < hunit; ++i) {
+            new_cell_states[i] = gates[1 * hunit + i] * cell_states[i] + gates[0 * hunit + i] * gates[2 * hunit + i];
+            new_hidden_layer[i] = gates[3 * hunit + i] * tanh_function(new_cell_states[i]);
+            output += new_hidden_layer[i] * model->dense_weights[i];
+        }
+        output += model->dense_bias;
+
+        window->output[t] = output;
+        float error = output - window->target[t];
+        loss += error * error;
+    }
+    return loss;
+}
+
+/**
+ * Accumulates the gradient of sum((output - target)^2) / count over the window into gradient
+ */
+static void backward(const lstm_model_t * model, const window_t * window, int length, int count,
+                     lstm_model_t * gradient) {
+    const int hunit = model->hunit;
+    float hidden_gradient[MODEL_MAX_HUNIT] = {0};
+    float cell_gradient[MODEL_MAX_HUNIT] = {0};
+    float gate_gradient[4 * MODEL_MAX_HUNIT];
+
+    for (int t = length - 1; t >= 0; --t) {
+        const float * gates = &window->gates[t * 4 * hunit];
+        const float * hidden_layer = &window->hidden_layer[t * hunit];
+        const float * cell_states = &window->cell_states[t * hunit];
+        const float * new_hidden_layer = &window->hidden_layer[(t + 1) * hunit];
+        const float * new_cell_states = &window->cell_states[(t + 1) * hunit];
+
+        float output_gradient = 2.0f * (window->output[t] - window->target[t]) / count;
+        gradient->dense_bias += output_gradient;
+
+        for (int i = 0; i < hunit; ++i) {
+            gradient->dense_weights[i] += output_gradient * new_hidden_layer[i];
+            float dh = hidden_gradient[i] + output_gradient * model->dense_weights[i];
+
+            float input_gate = gates[0 * hunit + i];
+            float forget_gate = gates[1 * hunit + i];
+            float cell_candidate = gates[2 * hunit + i];
+            float output_gate = gates[3 * hunit + i];
+            float cell_tanh = tanh_function(new_cell_states[i]);
+
+            float dc = cell_gradient[i] + dh * output_gate * (1 - cell_tanh * cell_tanh);
+            cell_gradient[i] = dc * forget_gate;
+
+            // All four gates are sigmoids in lstmCellSimple
+            gate_gradient[0 * hunit + i] = dc * cell_candidate * input_gate * (1 - input_gate);
+            gate_gradient[1 * hunit + i] = dc * cell_states[i] * forget_gate * (1 - forget_gate);
+            gate_gradient[2 * hunit + i] = dc * input_gate * cell_candidate * (1 - cell_candidate);
+            gate_gradient[3 * hunit + i] = dh * cell_tanh * output_gate * (1 - output_gate);
+        }
+
+        memset(hidden_gradient, 0, hunit * sizeof(float));
+        for (int k = 0; k < 4 * hunit; ++k) {
+            float dg = gate_gradient[k];
+            gradient->input_weights[k] += dg * window->input[t];
+            gradient->bias[k] += dg;
+            for (int j = 0; j < hunit; ++j) {
+                gradient->hidden_weights[k * hunit + j] += dg * hidden_layer[j];
+                hidden_gradient[j] += dg * model->hidden_weights[k * hunit + j];
+            }
+        }
+    }
+}
+
+static void adam_update(std::vector<float> * parameters, std::vector<float> * gradients, adam_t * adam,
+                        float learning_rate, float correction1, float correction2) {
+    if (adam->m.empty()) {
+        adam->m.assign(parameters->size(), 0.0f);
+        adam->v.assign(parameters->size(), 0.0f);
+    }
+    for (size_t k = 0; k < parameters->size(); ++k) {
+        float g = (*gradients)[k];
+        adam->m[k] = ADAM_BETA1 * adam->m[k] + (1 - ADAM_BETA1) * g;
+        adam->v[k] = ADAM_BETA2 * adam->v[k] + (1 - ADAM_BETA2) * g * g;
+        float m_hat = adam->m[k] / correction1;
+        float v_hat = adam->v[k] / correction2;
+        (*parameters)[k] -= learning_rate * m_hat / (sqrtf(v_hat) + ADAM_EPSILON);
+        (*gradients)[k] = 0;
+    }
+}
+
+scaler_t train_fit_scaler(const float * series, int length) {
+    // The supervised frame holds every difference plus the 0 filling the first lag
+    float x_min = 0;
+    float x_max = 0;
+    for (int i = 1; i < length; ++i) {
+        float diff = series[i] - series[i - 1];
+        x_min = diff < x_min ? diff : x_min;
+        x_max = diff > x_max ? diff : x_max;
+    }
+    scaler_t scaler = {x_min, x_max, 0.0f, 0.9f};
+    return scaler;
+}
+
+float train_lstm(const train_config_t * config, const float * series, int length,
+                 lstm_model_t * model, train_epoch_t epoch, void * context) {
+    const int hunit = config->hunit;
+    if (hunit < 1 || hunit > MODEL_MAX_HUNIT || config->window < 1 || length < 3) {
+        return -1;
+    }
+
+    init_model(model, hunit, config->seed);
+    model->scaler = train_fit_scaler(series, length);
+
+    // Supervised pairs as model_forecast_series feeds them: previous difference in, next out
+    pipeline_t pipeline;
+    pipeline_init(&pipeline, &model->scaler);
+    std::vector<float> inputs(length);
+    std::vector<float> targets(length);
+    int count = pipeline_push(&pipeline, series, length, inputs.data(), targets.data());
+
+    window_t window;
+    window.input.resize(config->window);
+    window.target.resize(config->window);
+    window.gates.resize(config->window * 4 * hunit);
+    window.hidden_layer.resize((config->window + 1) * hunit);
+    window.cell_states.resize((config->window + 1) * hunit);
+    window.output.resize(config->window);
+
+    lstm_model_t gradient;
+    gradient.hunit = hunit;
+    gradient.input_weights.assign(4 * hunit, 0.0f);
+    gradient.hidden_weights.assign(4 * hunit * hunit, 0.0f);
+    gradient.bias.assign(4 * hunit, 0.0f);
+    gradient.dense_weights.assign(hunit, 0.0f);
+    gradient.dense_bias = 0;
+
+    adam_t adam_input, adam_hidden, adam_bias, adam_dense, adam_dense_bias;
+    std::vector<float> dense_bias(1);
+    std::vector<float> dense_bias_gradient(1);
+    float correction1 = 1;
+    float correction2 = 1;
+
+    float loss = 0;
+    for (int e = 0; e < config->epochs; ++e) {
+        // Stateful pass over the series, starting from the exported initial state
+        memcpy(&window.hidden_layer[0], model->hidden_layer.data(), hunit * sizeof(float));
+        memcpy(&window.cell_states[0], model->cell_states.data(), hunit * sizeof(float));
+        double epoch_loss = 0;
+
+        for (int start = 0; start < count; start += config->window) {
+            int steps = count - start < config->window ? count - start : config->window;
+            memcpy(&window.input[0], &inputs[start], steps * sizeof(float));
+            memcpy(&window.target[0], &targets[start], steps * sizeof(float));
+
+            epoch_loss += forward(model, &window, steps);
+            backward(model, &window, steps, steps, &gradient);
+
+            correction1 *= ADAM_BETA1;
+            correction2 *= ADAM_BETA2;
+            dense_bias[0] = model->dense_bias;
+            dense_bias_gradient[0] = gradient.dense_bias;
+            adam_update(&model->input_weights, &gradient.input_weights, &adam_input,
+                        config->learning_rate, 1 - correction1, 1 - correction2);
+            adam_update(&model->hidden_weights, &gradient.hidden_weights, &adam_hidden,
+                        config->learning_rate, 1 - correction1, 1 - correction2);
+            adam_update(&model->bias, &gradient.bias, &adam_bias,
+                        config->learning_rate, 1 - correction1, 1 - correction2);
+            adam_update(&model->dense_weights, &gradient.dense_weights, &adam_dense,
+                        config->learning_rate, 1 - correction1, 1 - correction2);
+            adam_update(&dense_bias, &dense_bias_gradient, &adam_dense_bias,
+                        config->learning_rate, 1 - correction1, 1 - correction2);
+            model->dense_bias = dense_bias[0];
+            gradient.dense_bias = 0;
+
+            // Carry the state into the next window, not the gradient
+            memcpy(&window.hidden_layer[0], &window.hidden_layer[steps * hunit], hunit * sizeof(float));
+            memcpy(&window.cell_states[0], &window.cell_states[steps * hunit], hunit * sizeof(float));
+        }
+
+        loss = (float) (epoch_loss / count);
+        if (epoch && !epoch(context, e, model, loss)) {
+            break;
+        }
+    }
+    return loss;
+}
@@ -0,0 +1,49 @@
+//
+// Truncated BPTT trainer for the LSTM + dense architecture of handmade.cpp.
+//
+// Replaces fit_lstm from the training notebooks: MSE on the scaled differenced series,
+// Adam, no Python round-trip. The forward pass uses the node's activation functions and
+// weight layout, so a trained lstm_model_t goes through model_save and runs as is.
+//
+// Unlike the Keras model the notebooks export, the cell candidate is trained with the
+// sigmoid lstmCellSimple actually evaluates, and the state is carried across windows the
+// way the node runs it (gradients stop at window boundaries).
+//
+
+#ifndef CPP_TRAINER_H
+#define CPP_TRAINER_H
+
+#include "model.h"
+
+struct train_config_t {
+    int hunit;
+    int window;             // BPTT truncation length, in samples
+    int epochs;
+    float learning_rate;    // Adam step size
+    unsigned int seed;      // weight initialisation
+};
+
+/**
+ * Called after every epoch with the model as trained so far
+ * Returns false to stop training
+ */
+typedef bool (*train_epoch_t)(void * context, int epoch, const lstm_model_t * model, float loss);
+
+/**
+ * Fits the scaler on the differenced series the way the notebooks do:
+ * MinMaxScaler(feature_range=(0, 0.9)) over the supervised frame, 0 fill included
+ */
+scaler_t train_fit_scaler(const float * series, int length);
+
+/**
+ * config - hyperparameters
+ * series - raw training readings (not differenced)
+ * length - number of readings
+ * model - trained model, version 1, scaler fitted on series
+ * epoch - optional per epoch callback and its context
+ * Returns the training MSE of the last epoch, -1 if the configuration is invalid
+ */
+float train_lstm(const train_config_t * config, const float * series, int length,
+                 lstm_model_t * model, train_epoch_t epoch, void * context);
+
+#endif //CPP_TRAINER_H
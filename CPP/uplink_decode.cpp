@@ -0,0 +1,86 @@
+//
+// Decodes binary uplinks captured from the network server.
+//
+// Input lines are "<device> <hex payload>", output is one CSV line per record,
+// batched frames are unpacked in sequence order:
+// device,sequence,skipped,value,model_version
+//
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "payload.h"
+#include "uplink_batch.h"
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * hex - null or space terminated hexadecimal string
+ * frame - output bytes
+ * size - size of frame
+ * Returns the number of bytes parsed, -1 on invalid input
+ */
+static int parse_hex(const char * hex, uint8_t * frame, int size) {
+    int length = 0;
+    while (hex[0] && hex[0] != '\n' && hex[0] != '\r' && hex[0] != ' ') {
+        int high = hex_value(hex[0]);
+        int low = hex_value(hex[1]);
+        if (high < 0 || low < 0 || length == size) {
+            return -1;
+        }
+        frame[length++] = (uint8_t) (high << 4 | low);
+        hex += 2;
+    }
+    return length;
+}
+
+int main(int argc, char ** argv) {
+    FILE * input = stdin;
+    if (argc > 1 && !(input = fopen(argv[1], "r"))) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    char line[2 * BATCH_MAX_SIZE + 80];
+    char device[64];
+    uint8_t frame[BATCH_MAX_SIZE];
+    uplink_t records[BATCH_MAX_SIZE / 2];
+    int errors = 0;
+
+    printf("device,sequence,skipped,value,model_version\n");
+    while (fgets(line, sizeof(line), input)) {
+        char * separator = strchr(line, ' ');
+        if (!separator || separator - line >= (int) sizeof(device)) {
+            errors++;
+            continue;
+        }
+        memcpy(device, line, separator - line);
+        device[separator - line] = 0;
+
+        int length = parse_hex(separator + 1, frame, sizeof(frame));
+        int count = length < 0 ? -1 : payload_decode_batch(frame, length, records, sizeof(records) / sizeof(records[0]));
+        if (count < 0) {
+            errors++;
+            continue;
+        }
+        for (int i = 0; i < count; ++i) {
+            printf("%s,%u,%u,%.2f,%d\n", device, records[i].sequence, records[i].skipped,
+                   payload_dequantize(records[i].value),
+                   records[i].has_model_version ? records[i].model_version : -1);
+        }
+    }
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (errors) {
+        fprintf(stderr, "%d malformed lines\n", errors);
+    }
+    return errors ? 2 : 0;
+}
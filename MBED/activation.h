@@ -0,0 +1,77 @@
+//
+// Activations of the LSTM kernels, inline so that generated kernels pay no call per gate.
+//
+// handmade.cpp wraps them as sigmoid_function/tanh_function, kernels generated by the host
+// codegen tool call them directly. Same expressions either way, hence the same bits.
+//
+
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "deterministic.h"
+
+#ifdef DETERMINISTIC_MATH
+
+/**
+ * exp without libm: x = k*ln(2) + r with |r| <= ln(2)/2, e^r by its degree 6 Taylor
+ * polynomial (relative error ~1e-7), 2^k written directly in the exponent bits.
+ * Input is clamped to the range where the result is a normal float.
+ */
+static inline float activation_exp (float input) {
+    if (input > 88.0f) {
+        input = 88.0f;
+    }
+    if (input < -87.0f) {
+        input = -87.0f;
+    }
+
+    float k_float = input * 1.44269504f;
+    int k = (int) (k_float < 0 ? k_float - 0.5f : k_float + 0.5f);
+
+    // ln(2) split in a high part exact for any k and a low correction (Cody-Waite)
+    float r = (input - (float) k * 0.693145751953125f) - (float) k * 1.42860677e-06f;
+
+    float p = 1.0f + r * (1.0f + r * (0.5f + r * (1.66666672e-01f + r * (4.16666679e-02f
+              + r * (8.33333377e-03f + r * 1.38888892e-03f)))));
+
+    union {
+        uint32_t bits;
+        float value;
+    } scale;
+    scale.bits = (uint32_t) (k + 127) << 23;
+
+    return p * scale.value;
+}
+
+static inline float activation_sigmoid (float input) {
+    return 1/(1+(activation_exp(-input)));
+}
+
+static inline float activation_tanh (float input) {
+    // tanh is +/-1 to float precision beyond 9
+    if (input > 9.0f) {
+        return 1.0f;
+    }
+    if (input < -9.0f) {
+        return -1.0f;
+    }
+    float e = activation_exp(2.0f * input);
+    return (e - 1.0f) / (e + 1.0f);
+}
+
+#else
+
+static inline float activation_sigmoid (float input) {
+    return 1/(1+(exp(-input)));
+}
+
+static inline float activation_tanh (float input) {
+    return tanh(input);
+}
+
+#endif //DETERMINISTIC_MATH
+
+#endif //ACTIVATION_H
@@ -0,0 +1,44 @@
+//
+// Conformance replay: hashes the dual prediction of a series so two builds can be compared.
+//
+
+#include <string.h>
+
+#include "conformance.h"
+#include "deterministic.h"
+#include "dual_prediction.h"
+#include "node_sample.h"
+
+uint32_t conformance_hash_bytes(uint32_t hash, const uint8_t * bytes, int length) {
+    for (int i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t conformance_hash_float(uint32_t hash, float value) {
+    uint8_t bytes[sizeof(float)];
+    memcpy(bytes, &value, sizeof(value));
+    return conformance_hash_bytes(hash, bytes, sizeof(bytes));
+}
+
+uint32_t conformance_replay(const float * series, int length, float threshold, int * transmitted) {
+    dual_prediction_t prediction;
+    uint32_t hash = CONFORMANCE_HASH_SEED;
+    int count = 0;
+
+    for (int i = 0; i < length; ++i) {
+        node_sample_t sample;
+        node_sample_step(&prediction, (uint32_t) i, series[i], threshold, NULL, &sample);
+        if (i > 0) {
+            hash = conformance_hash_float(hash, sample.forecast);
+        }
+        hash = conformance_hash_float(hash, sample.value);
+        count += sample.transmitted;
+    }
+
+    if (transmitted) {
+        *transmitted = count;
+    }
+    return hash;
+}
@@ -0,0 +1,35 @@
+//
+// Conformance replay: hashes the dual prediction of a series so two builds can be compared.
+//
+
+#ifndef CONFORMANCE_H
+#define CONFORMANCE_H
+
+#include <stdint.h>
+
+// FNV-1a offset basis, the hash of nothing
+#define CONFORMANCE_HASH_SEED           2166136261u
+
+/**
+ * Folds length bytes into an FNV-1a hash
+ */
+uint32_t conformance_hash_bytes(uint32_t hash, const uint8_t * bytes, int length);
+
+/**
+ * Folds the bits of value into an FNV-1a hash
+ */
+uint32_t conformance_hash_float(uint32_t hash, float value);
+
+/**
+ * Replays series through the node's dual prediction logic (forecast, relative error against
+ * threshold, quantized correction) and hashes the bits of every forecast and reconstructed value.
+ * Two builds printing the same hash produced the same bits for every sample.
+ * series - measured values
+ * length - number of samples
+ * threshold - relative error above which a sample is transmitted
+ * transmitted - number of samples that would have been transmitted, may be null
+ * Returns the FNV-1a hash of the replay
+ */
+uint32_t conformance_replay(const float * series, int length, float threshold, int * transmitted);
+
+#endif //CONFORMANCE_H
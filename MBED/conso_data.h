@@ -5,11 +5,9 @@
 #ifndef CPP_CONSO_DATA_H
 #define CPP_CONSO_DATA_H
 
-#define HUNIT 3
-
 #endif //CPP_CONSO_DATA_H
 
-static float conso_data[] = {191.95605 , 164.897   , 182.8583  , 155.27605 , 165.86206 ,
+static const float conso_data[] = {191.95605 , 164.897   , 182.8583  , 155.27605 , 165.86206 ,
                             145.82147 , 163.62976 , 157.1036  , 183.63597 , 150.56335 ,
                             164.10635 , 134.9884  , 141.60818 , 156.79782 , 128.0335  ,
                             139.9927  , 159.88116 , 164.71202 , 162.61412 , 144.54448 ,
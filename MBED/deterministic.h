@@ -0,0 +1,36 @@
+//
+// Deterministic arithmetic mode.
+//
+// Dual prediction only works if the node and the server compute the very same bits. With
+// DETERMINISTIC_MATH defined, every file including this header:
+//  - refuses to build with excess precision (x87) or -ffast-math,
+//  - disables FMA contraction, so a*b+c is always two rounded operations,
+// and activation.h replaces libm's exp/tanh by its own implementations built only on
+// IEEE-754 +, -, *, / which give identical results on x86 and Cortex-M (hard or soft float).
+// Evaluation order is the source order, no reassociation is allowed anywhere.
+//
+
+#ifndef DETERMINISTIC_H
+#define DETERMINISTIC_H
+
+#ifdef DETERMINISTIC_MATH
+
+#include <float.h>
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+#error "DETERMINISTIC_MATH needs float expressions evaluated in float (FLT_EVAL_METHOD == 0)"
+#endif
+
+#ifdef __FAST_MATH__
+#error "DETERMINISTIC_MATH cannot be used with -ffast-math"
+#endif
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#endif //DETERMINISTIC_MATH
+
+#endif //DETERMINISTIC_H
@@ -1,12 +0,0 @@
-//
-// Created by spiderweak on 3/10/21.
-//
-
-#ifndef CPP_CONSO_DATA_H
-#define CPP_CONSO_DATA_H
-
-#define HUNIT 3
-
-#endif //CPP_CONSO_DATA_H
-
-static float diff_scaled_value[] = {0.5023871583599954, 0.43552216574537284, 0.4978891489810964, 0.41070939815803115, 0.46572284879334597, 0.4100700537693932, 0.4567104777059718, 0.41928573819963855, 0.4655358691342932, 0.4357999502448312, 0.47619641333518076, 0.40336101178677075, 0.4603238204610756, 0.4081934887687899, 0.45186386723955274, 0.4623359587665226, 0.4086256042054222, 0.45838848403193877, 0.4680777707098846, 0.4496778572427747, 0.4412111356111764, 0.42169417344101573, 0.4292454815942338, 0.44496109583355986, 0.4332666630093358, 0.4347611577871977, 0.4600470987698109, 0.4413483683884629, 0.4276901923231189, 0.4556462710804794, 0.43944747999683104, 0.43293141228438875, 0.4637760265774145, 0.42801968150891084, 0.4286432049720695, 0.4605450430542978, 0.45345438766999957, 0.43693783558220506, 0.4498683702729275, 0.4460482647097626, 0.4237254609397064, 0.46406371197425594, 0.4663568325266212, 0.4103154319418239, 0.49234753653905566, 0.43882781620553357, 0.43526196419550434, 0.4836661462980961, 0.4866725323458319, 0.463893364331146, 0.44379208140356646, 0.4623032541073704, 0.44457721697231345, 0.4462153773138971, 0.4905018675590996, 0.4442561743147974, 0.4271191193766052, 0.41037647815280703, 0.477978164657455, 0.4335804338213163, 0.44568626664527516, 0.446172585299784, 0.47168531463431773, 0.4375559704213643, 0.41087706081202024, 0.48133270429452407, 0.34874807202864516, 0.5330253268228424, 0.38831216984578215, 0.42723793014520156, 0.49923925101068295, 0.42682488931878176, 0.4441632811495201, 0.4242745225691567, 0.5043073730795699, 0.4621143352895081, 0.390982522046744, 0.43702456632453496, 0.4672897264029234, 0.5127100838246974, 0.4691407280696055, 0.3649418567263287, 0.43020502958128753, 0.46794020230895805, 0.43224327194763146, 0.4562205977117263, 0.5098495635401018, 0.42115840623686507, 0.4332062507541173, 0.417520544310276, 0.48677931660065793, 0.3951018547308182, 0.43622790767747777, 0.491977716579178, 0.39433793803442885, 0.4626565912173674, 0.44325553107758886, 0.4332941841478242, 0.435707131662585, 0.4709689446202762, 0.38832430823409925, 0.4692802729208571, 0.44670872541909035, 0.46257268530734175, 0.4258257004506804, 0.4940814055553419, 0.5988408429606215, 0.25769831959458656, 0.5747717427767163, 0.30988928729118403, 0.579514179394399, 0.4924829047405638, 0.29239177256352156, 0.5948026939059365, 0.2375754448794937, 0.4263984608382735, 0.5073757562719357, 0.5315863031743864, 0.5306249651945855, 0.2863691182164247, 0.44304420005887085, 0.5799850593614632, 0.314566426465109, 0.32794871057540975, 0.4498232755077281, 0.5026089310030721, 0.411205449898103, 0.6107372839246719, 0.23298088776679177, 0.45468508226674076, 0.4588178212506613, 0.44521747500308273, 0.4549052886661637, 0.49492094944530113, 0.34862105712662406, 0.5559838856731633, 0.36137831679026455, 0.4158563917823422, 0.4328099351724293, 0.40727516655219553, 0.4394324235474209, 0.479240053606968, 0.4134557504677185, 0.4636756191717505, 0.4567524493067424, 0.4431756712970022, 0.447831554307054, 0.38149522486286663, 0.5072823596711982, 0.43089292752319364, 0.4557765676358704, 0.4093578417593374, 0.43160659390235656, 0.4255183064878619, 0.4291515815580362, 0.4739333777129992, 0.3896504877564496, 0.41660428244991665, 0.49019640343221166, 0.4408525217517267, 0.4382154708741662, 0.4766456082859427, 0.37860345428822595, 0.4381303623127634, 0.46384961206050707, 0.4327815003918095, 0.42614393692165004, 0.48636800050683315, 0.4116184068186127, 0.4388399545938506, 0.44488339896087603, 0.44869582247183415, 0.4264966214301246, 0.45161706266665164, 0.4523091838726957, 0.4346639388061146, 0.44675385747580526, 0.44388320322185437, 0.45223646541734014, 0.4420875421642736, 0.4569042257751, 0.4319758731352585, 0.45151565771294616, 0.4510070014406127, 0.4410694651435375, 0.45797065124576863, 0.4767980932930961, 0.4853365451548874, 0.47012936343880146, 0.4727357979820815, 0.4426746970768755, 0.417343484194364, 0.5373480847243345, 0.38361163024583894, 0.4382779714542564, 0.4871909776410017, 0.4158684555876281, 0.47270087447775305, 0.4516367619097499, 0.4110036655073701, 0.4802695604772253, 0.48932080796957805, 0.5364075367644622, 0.281214349311118, 0.5385409843700485, 0.458072755415391, 0.3808572043230314, 0.4159760043185232, 0.4240669579935109, 0.40997337551528584, 0.5142563392261662, 0.4021746754477965, 0.42346287273284156, 0.47587882014285465, 0.40393966423382344, 0.4463633873391824, 0.4414283773351118, 0.5484776256707501, 0.3460780554513235, 0.5293251694194987, 0.39519042208028976, 0.4362264533083707, 0.4675557640749781, 0.44375143365159847, 0.5344631944343159, 0.3497398958224221, 0.4538519898089746, 0.452069753696998, 0.48733615351110393, 0.40488338197251894, 0.459817588137254, 0.3809920504433215, 0.4657137123720321, 0.49483182272309606, 0.3663000137232777, 0.5484429632070306, 0.3387287554379317, 0.4327979832416901, 0.44307876929380147, 0.4518318338276807, 0.4701618070573447, 0.4286136887374982, 0.45579681692882323, 0.44891041649816427, 0.47478401582883956, 0.4255184556539241, 0.42204792075768405, 0.5474421708037598, 0.3105747799303361, 0.4552617955549839, 0.453316819269073, 0.44460667726961134, 0.4274972180529387, 0.43560208146323287, 0.431689828565102, 0.44636888783772855, 0.4463315963221616, 0.42503361001428014, 0.4582874426705101, 0.4364311091458022, 0.546091229715073, 0.5602185423691284, 0.3523291949142991, 0.49653380749357257, 0.2954024657813053, 0.4266244847141249, 0.4346607503815336, 0.43045546075407753, 0.4720623318566998, 0.5277057107729719, 0.4349391501909988, 0.3884321925886345, 0.434325294553251, 0.431963772038457, 0.4518826248718829, 0.44899305449666066, 0.4063024546601467, 0.4498926377266827, 0.4132112672916614, 0.47876382230742, 0.4282008343686563, 0.41988133964051644, 0.4625298187101975, 0.40247662484934227, 0.47859078967518925, 0.46363937181861936, 0.39336017314202065, 0.41111115830099193, 0.4511235001352439, 0.4599053164276253, 0.40867637660386663, 0.45967166643684043, 0.42456485566360336, 0.4479869666981794, 0.4350393524933273, 0.43355086164947165, 0.44034132965633466, 0.4481078471458897, 0.42548541537113177, 0.43921512588621214, 0.45365050375036625, 0.4947481592079216, 0.386656314680062, 0.4420326304076012, 0.4310195695100591, 0.4425688637556965, 0.44961056470293415, 0.44984626572707515, 0.42875331749465984, 0.44778480006941196, 0.46519949966387913, 0.4230567121910439, 0.4430887074827, 0.4471911284644647, 0.42260216590779814, 0.46148681231130495, 0.4399198329787601, 0.43220922479391877, 0.4530464464583336, 0.4522737196413915, 0.42452498171058334, 0.5175327251694858, 0.3946891495280386, 0.41598790031198907, 0.4582470373133932, 0.49171936095933005, 0.3947768405268943, 0.474691402349929, 0.46178266455005545, 0.3918909060744398, 0.4641074176305004, 0.47047507443386505, 0.46895635881664244, 0.4316538049610643, 0.49904988469463385, 0.4647640839281192, 0.42652939134942913, 0.461163345705277, 0.4244614835824517, 0.4992997564946903, 0.5063777607323324, 0.36560169280277066, 0.513730864480312, 0.41274756594134393, 0.39953837040054735, 0.4856539891811512, 0.4076615439449849, 0.47601894301259756, 0.4503027698148882, 0.37912449134372767, 0.5311939218475907, 0.42494453922934844, 0.4672815595610142, 0.39517431214556487, 0.443486141809855, 0.47778568449985614, 0.4334655013703389, 0.4701317873873133, 0.40391693505508536, 0.43378516424177893, 0.49396621206375557, 0.43092039272440874, 0.4520176201582353, 0.60513393537861, 0.23293145786290775, 0.43406257582608165, 0.4703901057156457, 0.4253878607664086, 0.5118395506853021, 0.44090642663747875, 0.36628550732372217, 0.4719831992606667, 0.47519869748194427, 0.39705831680352377, 0.4348115013332131, 0.4690364237005647, 0.5340225578863765, 0.4608357956782945, 0.343912574433865, 0.425759769051158, 0.45354090398611496, 0.40062327381717944, 0.5022131934398755, 0.398318714092414, 0.5790116575763764, 0.4315054966036545, 0.393939030692409, 0.4540934150807552, 0.42845941373759766, 0.3718540255942444, 0.4901575922873853, 0.44303621967453954, 0.4855416857820213, 0.37739360564868674, 0.5974898832261768, 0.35391859659927893, 0.3827050362108903, 0.47075552527668646, 0.4048316959319431, 0.4849715358005179, 0.5084091041682964, 0.43523718398341005, 0.39400112106582796, 0.44428115963022724, 0.392586206382186, 0.4793025541870582, 0.4452353003475238, 0.395610399128605, 0.5149353431416096, 0.5546314902153693, 0.35836430462759533, 0.4003548867796439, 0.46098902651575924, 0.4151882956352021, 0.48406553842981836, 0.4565977641001706, 0.3710694866897465, 0.5442198482351335, 0.3259199029625043, 0.4561140185602359, 0.40331091063560653, 0.44615131049015305, 0.407819044660982, 0.4994610422995175, 0.5100439828565102, 0.3773679117944611, 0.3960904341627408, 0.47072654976909095, 0.463883202393154, 0.44216303883753894, 0.47764420048979506, 0.3978381942685758, 0.4349431776746801, 0.40279539272440873, 0.4361117818980022, 0.41054244404283785, 0.47706791605398086, 0.44538299339492676, 0.41628647483137604, 0.45661424695005126, 0.45255799286455856, 0.39378516589917967, 0.48695812941780153, 0.4528362807994771, 0.40880372712952784, 0.43800727234275577, 0.44334036927550374, 0.4258329163589426, 0.4639555479333539, 0.44013076311368576, 0.41909118836292564, 0.4519212402362525, 0.4497977494653225, 0.43584781390506144, 0.44717015198695825, 0.44292035493567294, 0.43230542758120266, 0.45765950016275675, 0.4515683506244423, 0.4125261755363017, 0.46692258210928766, 0.4283743144990738, 0.4431812184099428, 0.43548856608984704, 0.4514320128435294, 0.4464840533606782, 0.4299537966409129, 0.4616971178133449, 0.43955911214868076, 0.4414071398169964, 0.43685440513900287, 0.440811072232174, 0.4637635618883363, 0.44537978632458797, 0.45505980606091545, 0.4549742779699626, 0.4439645360173059, 0.48059528321994505, 0.4529046361475113, 0.46520848691913075, 0.4547011735557079, 0.47116603028004767, 0.5344898205764307, 0.4187760004733536, 0.39643439245657275, 0.5277679130209376, 0.5139060227289302, 0.5702312024243131, 0.14428592672896723, 0.5298376853636934, 0.3930977341012181, 0.4135583394270432, 0.4480614751462822, 0.5520832677278893, 0.3882375308773749, 0.4165857951810743, 0.5213966202948052, 0.47103252665431794, 0.3662765573599861, 0.44324475382959005, 0.4157751522156795, 0.4215537895306639, 0.4946800276089807, 0.35419610141237057, 0.5364409686081679, 0.3866562214512731, 0.5011375569648617, 0.4784127786256303, 0.44233991249587307, 0.42725590465570484, 0.4106823245177295, 0.5284251013997743, 0.3934174715556893, 0.45095656466580836, 0.5184559978347717, 0.40906894438824015, 0.41278590161934675, 0.48122787784426535, 0.36284894499816356, 0.44579217454948533, 0.44707958954140387, 0.4415821116080367, 0.5433142610711051, 0.5721373955340344, 0.26080984907046334, 0.4840377935422365, 0.4100267396740622, 0.35656517545906685, 0.5216813037246434, 0.43326017428562713, 0.466213978053363, 0.43739673564989334, 0.4746879155932235, 0.503406484646503, 0.3410107724415368, 0.5880973437833552, 0.28506108101639765, 0.45799552468665183, 0.438032742447888, 0.5526822626966837, 0.38419244560079446, 0.34610647158618546, 0.44426042554757206, 0.6485446157349644, 0.2388043867750032, 0.445535832671478, 0.4326300222555765, 0.4675542724143555, 0.44472433200122513, 0.6839859873401106, 0.21333278998213984, 0.402233968957548, 0.5142149083523714, 0.3654861450417864, 0.43346475554002756, 0.4466686370398558, 0.43617857100238266, 0.46961106730969393, 0.42482283836829565, 0.4624918559473503, 0.4206625223086133, 0.4820492794119012, 0.39319193246954026, 0.4754826164357134, 0.46399160882890716, 0.5479845386061658, 0.29644159386257896, 0.4713206781951039, 0.4547731275349943, 0.5466605779289917, 0.3780510550681324, 0.43168255671956646, 0.5622482449784074, 0.3314490413925878, 0.45770248795732654, 0.39998972825921214, 0.4154192046995928, 0.6403760584160818, 0.4491199202326195, 0.21812342588369288, 0.4427262525971469, 0.43223847998788106, 0.4303679002755263, 0.4023722831887859, 0.44210889155693567, 0.44145438816721977, 0.4324098531476691, 0.43935396219866796, 0.5095966897730422, 0.4438781129299795, 0.35739276741828685, 0.4634738534267754, 0.4287790206717644, 0.4333187406108251, 0.45870469743818887, 0.4264248445855371, 0.4493811100076506, 0.44906036568225904, 0.4259094012573704, 0.4496686275926719, 0.4533702580108805, 0.4199875179082145, 0.4530361912915527, 0.44090165332348613, 0.43206093508226673, 0.44646031731101987, 0.45788746319741763, 0.4284936100573726, 0.45296760287154614, 0.43593146809735706, 0.44226720336339637, 0.45496122593951416, 0.44005508930572146, 0.4405608927771141, 0.4605304527488322, 0.4509009257245824, 0.4181631237378894, 0.4806937794354363, 0.4565783911578336, 0.4415725463342937, 0.4841606504402719, 0.45709855186271947, 0.45074385386101434, 0.45147838484313696, 0.4777769023479401, 0.43406598799975604, 0.5061152657542565, 0.4548499853485779, 0.37379456418980284, 0.48240319454038955, 0.45118124604709936, 0.4664764357399233, 0.47047699494691675, 0.42853653259179014, 0.3880885139811693, 0.5043793829961296, 0.5189901987952685, 0.3488172291442641, 0.5038047953242738, 0.4401809574936389, 0.5662615205922091, 0.2808717521576042, 0.4673311199852027, 0.4275426391188993, 0.3861343266909133, 0.4549222190142311, 0.4337931446261103, 0.4905227135163015, 0.4360401448965981, 0.44646804597762113, 0.4172561101733906, 0.4356346742478384, 0.49086296130433454, 0.5704983215503193, 0.4202381262157034, 0.3733816352379298, 0.4062790169426128, 0.3959232003611807, 0.4613586973095746, 0.5086012300564975, 0.4146088600663225, 0.42539785489258053, 0.5152638068107235, 0.45692473610866186, 0.36263209483514164, 0.4150851473031439, 0.5346014713740382, 0.43346471824851196, 0.5462722240858773, 0.33195184289697727, 0.49125105410684, 0.404884500717986, 0.3593220626219018, 0.4901637453874539, 0.4731682490423539, 0.4124804841068533, 0.4807060949584523, 0.41912620509604304, 0.45879154937794436, 0.4442194421719639, 0.41251054106840024, 0.5212917938445464, 0.33322732460391435, 0.424217317384277, 0.5085195243458902, 0.4292999644984772, 0.35788734614349377, 0.5023459885268095, 0.43881989175847563, 0.44564673763877416, 0.4439787627304947, 0.5106759435250658, 0.4010168484724732, 0.4063981260433337, 0.44048167627517093, 0.4344706195894154, 0.4553291440320979, 0.4549681621614096, 0.41028986860790273, 0.4460357627291688, 0.4181832891249322, 0.6295666278392931, 0.26995514576507607, 0.4042915842662289, 0.48944955692707304, 0.4620919044428946, 0.42551019558322606, 0.4178785987969923, 0.46407212121101626, 0.41080695276275436, 0.49328713356528103, 0.49137366861002424, 0.40506376103331637, 0.49435743735356863, 0.4802575899007283, 0.35893945167218466, 0.4108873532703167, 0.5109011096960592, 0.42155623212493354};
@@ -0,0 +1,141 @@
+//
+// Dual prediction state, advanced identically by the node and the server mirror.
+//
+
+#include <string.h>
+
+#include "deterministic.h"
+#include "dual_prediction.h"
+#include "handmade.h"
+#include "kernel.h"
+
+#ifdef ONLINE_DENSE
+// Normalised LMS step size, stable for 0 < rate < 2
+#define ONLINE_DENSE_RATE 0.05f
+#endif
+
+#ifdef ANOMALY_GATE
+// Outlier bound, in mean absolute residuals
+#define ANOMALY_GATE_K 4.0f
+// Weight of a new correction in the mean absolute residual
+#define ANOMALY_GATE_RATE 0.1f
+#endif
+
+void dual_prediction_init(dual_prediction_t * state, float first_value, uint32_t sequence) {
+    memcpy(state->hidden_layer, lstm_cell_hidden_layer, sizeof(state->hidden_layer));
+    memcpy(state->cell_states, lstm_cell_cell_states, sizeof(state->cell_states));
+    state->scaler = model_scaler();
+    difference_init(&state->differencer, first_value);
+    state->previous_diff = 0;
+    state->sequence = sequence;
+#ifdef ONLINE_DENSE
+    memcpy(state->dense_weights, dense_weights, sizeof(state->dense_weights));
+    state->dense_bias = dense_bias;
+    state->output = 0;
+#endif
+#ifdef ANOMALY_GATE
+    state->forecast = first_value;
+    state->residual_scale = 0;
+    state->gated = 0;
+    state->holding = false;
+#endif
+}
+
+float dual_prediction_predict(dual_prediction_t * state) {
+    // 1. Scaler
+#ifdef MODEL_SCALER_FOLDED
+    // Scaling is part of the weights, the model takes raw differences
+    float x_diff_scaled = state->previous_diff;
+#else
+    float x_diff_scaled = scale_value(&state->scaler, state->previous_diff);
+#endif
+
+    // 2. Neural Network Prediction
+#ifdef GENERATED_KERNEL
+    kernel_step(x_diff_scaled, state->hidden_layer, state->cell_states);
+#else
+    lstmCellSimple(x_diff_scaled, lstm_cell_input_weights, lstm_cell_hidden_weights,
+                   lstm_cell_bias, state->hidden_layer, state->cell_states);
+#endif
+
+#ifdef ONLINE_DENSE
+    float y_diff_scaled = dense_nn(state->hidden_layer, state->dense_weights, state->dense_bias);
+    state->output = y_diff_scaled;
+#elif defined(GENERATED_KERNEL)
+    float y_diff_scaled = kernel_dense(state->hidden_layer);
+#else
+    float y_diff_scaled = dense_nn(state->hidden_layer, dense_weights, dense_bias);
+#endif
+
+    // 3. Unscaling and coming back to real data
+#ifdef MODEL_SCALER_FOLDED
+    float y_diff = y_diff_scaled;
+#else
+    float y_diff = invert_scale_value(&state->scaler, y_diff_scaled);
+#endif
+
+#ifdef ANOMALY_GATE
+    state->forecast = invert_difference(&state->differencer, y_diff);
+    return state->forecast;
+#else
+    return invert_difference(&state->differencer, y_diff);
+#endif
+}
+
+static void advance(dual_prediction_t * state, float value) {
+    state->previous_diff = difference_push(&state->differencer, value);
+    state->sequence++;
+}
+
+void dual_prediction_commit(dual_prediction_t * state, float value) {
+#ifdef ANOMALY_GATE
+    // The forecast was good enough, whatever was gated before is over
+    state->holding = false;
+#endif
+    advance(state, value);
+}
+
+void dual_prediction_correct(dual_prediction_t * state, float value) {
+#ifdef ANOMALY_GATE
+    float residual = value - state->forecast;
+    if (residual < 0) {
+        residual = - residual;
+    }
+    float bound = ANOMALY_GATE_K * state->residual_scale;
+    bool outlier = state->residual_scale > 0 && residual > bound && !state->holding;
+
+    if (state->residual_scale == 0) {
+        state->residual_scale = residual;
+    } else {
+        state->residual_scale += ANOMALY_GATE_RATE * ((residual < bound ? residual : bound) - state->residual_scale);
+    }
+    state->holding = outlier;
+    if (outlier) {
+        // Neither the LSTM input nor the dense head learn from it
+        state->gated++;
+        advance(state, state->forecast);
+        return;
+    }
+#endif
+#ifdef ONLINE_DENSE
+    // Target in the dense output space, from the same hidden state as the forecast
+    float target = value - state->differencer.previous;
+#ifndef MODEL_SCALER_FOLDED
+    target = scale_value(&state->scaler, target);
+#endif
+    float error = target - state->output;
+
+    // The bias is a weight on a constant 1 input
+    float norm = 1.0f;
+    for (int i = 0; i < HUNIT; ++i) {
+        norm += state->hidden_layer[i] * state->hidden_layer[i];
+    }
+    float step = ONLINE_DENSE_RATE * error / norm;
+
+    for (int i = 0; i < HUNIT; ++i) {
+        state->dense_weights[i] += step * state->hidden_layer[i];
+    }
+    state->dense_bias += step;
+#endif
+    advance(state, value);
+}
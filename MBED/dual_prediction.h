@@ -0,0 +1,75 @@
+//
+// Dual prediction state, advanced identically by the node and the server mirror.
+//
+// Both sides only ever feed the model with the reconstructed series (predictions when a
+// sample was skipped, transmitted values otherwise), never with raw readings, so as long
+// as they see the same corrections they stay bit-exact.
+//
+// With ONLINE_DENSE defined (on both the node and the server build) each state also carries
+// its own copy of the dense head, refined by a normalised LMS step on every transmitted
+// sample, the only ones whose true value both sides know. Cost per correction: 2*HUNIT+2
+// multiply-adds and one division, HUNIT+1 floats of state.
+//
+// With ANOMALY_GATE defined (on both sides as well) a transmitted value whose forecast
+// residual is far above the usual one is treated as an outlier: it is still the
+// reconstructed value of its sample, but the model carries on from its own forecast, so a
+// spike does not feed two huge differences through the LSTM state. A second outlier in a
+// row is taken as a level shift and accepted. The usual residual is a running mean of the
+// absolute residuals of corrections, clipped at the outlier bound so spikes barely move it.
+//
+
+#ifndef DUAL_PREDICTION_H
+#define DUAL_PREDICTION_H
+
+#include <stdint.h>
+
+#include "parameters.h"
+#include "preprocess.h"
+
+struct dual_prediction_t {
+    float hidden_layer[HUNIT];
+    float cell_states[HUNIT];
+    scaler_t scaler;
+    differencer_t differencer;  // holds the last reconstructed value
+    float previous_diff;        // last reconstructed difference, next LSTM input
+    uint32_t sequence;          // sequence of the last reconstructed value
+#ifdef ONLINE_DENSE
+    float dense_weights[HUNIT]; // dense head adapted on line
+    float dense_bias;
+    float output;               // dense output of the last forecast
+#endif
+#ifdef ANOMALY_GATE
+    float forecast;             // last forecast
+    float residual_scale;       // running mean absolute residual of corrections, 0 until the first
+    uint32_t gated;             // corrections gated as outliers
+    bool holding;               // the last correction was gated
+#endif
+};
+
+/**
+ * Starts a series from its first transmitted value
+ * state - state to initialise
+ * first_value - reconstructed value of sample sequence
+ * sequence - sequence of the first sample
+ */
+void dual_prediction_init(dual_prediction_t * state, float first_value, uint32_t sequence);
+
+/**
+ * Runs the model one step and returns the forecast of sample state->sequence + 1.
+ * Must be followed by exactly one dual_prediction_commit.
+ */
+float dual_prediction_predict(dual_prediction_t * state);
+
+/**
+ * Records the forecast as the reconstructed value of sample state->sequence + 1 (skipped sample)
+ */
+void dual_prediction_commit(dual_prediction_t * state, float value);
+
+/**
+ * Records the transmitted value of sample state->sequence + 1 (the value as the server
+ * decodes it) and, with ONLINE_DENSE, adapts the dense head to it. With ANOMALY_GATE the
+ * model may carry on from the forecast instead, see above.
+ */
+void dual_prediction_correct(dual_prediction_t * state, float value);
+
+#endif //DUAL_PREDICTION_H
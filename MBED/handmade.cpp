@@ -0,0 +1,76 @@
+//
+// LSTM cell and dense layer by hand, shared by the node firmware and the host tools.
+//
+
+#include "activation.h"
+#include "deterministic.h"
+#include "handmade.h"
+#include "parameters.h"
+
+void lstmCellSimple(float input, const float * input_weights, const float * hidden_weights,
+		const float * bias, float * hidden_layer, float * cell_states) {
+    /**
+     * input - float
+     * input_weight - float array (4*HUNIT) - Weights W_i, W_f, W_c, W_o
+     * hidden_weights - float array (4*HUNIT*HUNIT) - Weights U_i, U_f, U_c, U_o
+     * bias - float array (4*HUNIT) - Bias B_i, B_f, B_c, B_o
+     * hidden_layer - float array (4*HUNIT) - Outputs h
+     * cell_states - float array (4*HUNIT) - Cell states
+     * HUNIT - size of hidden layer
+     */
+
+    // Only the new h needs a buffer: every gate reads the whole previous h, but c is only
+    // read by its own unit and can be updated in place. One float[HUNIT] of stack.
+    float new_hidden_layer[HUNIT];
+
+    for (int i = 0; i < HUNIT; ++i) {
+        float input_gate = input_weights[0 * HUNIT + i] * input;
+        float forget_gate = input_weights[1 * HUNIT + i] * input;
+        float cell_candidate = input_weights[2 * HUNIT + i] * input;
+        float output_gate = input_weights[3 * HUNIT + i] * input;
+
+        for (int j = 0; j < HUNIT; ++j) {
+            input_gate += hidden_weights[(0 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
+            forget_gate += hidden_weights[(1 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
+            cell_candidate += hidden_weights[(2 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
+            output_gate += hidden_weights[(3 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
+        }
+
+        input_gate += bias[0 * HUNIT + i];
+        forget_gate += bias[1 * HUNIT + i];
+        cell_candidate += bias[2 * HUNIT + i];
+        output_gate += bias[3 * HUNIT + i];
+
+        input_gate = sigmoid_function(input_gate);
+        forget_gate = sigmoid_function(forget_gate);
+        cell_candidate = sigmoid_function(cell_candidate);
+        output_gate = sigmoid_function(output_gate);
+
+        cell_states[i] = forget_gate * cell_states[i] + input_gate * cell_candidate;
+        new_hidden_layer[i] = output_gate * tanh_function(cell_states[i]);
+    }
+
+    for (int i = 0; i < HUNIT; ++i) {
+	    hidden_layer[i] = new_hidden_layer[i];
+    }
+
+    return;
+}
+
+
+float dense_nn(const float * input, const float * Weight, float bias) {
+    float output = 0;
+    for (int i = 0; i < HUNIT; ++i) {
+        output += input[i] * Weight[i];
+    }
+    output += bias;
+    return output;
+}
+
+float sigmoid_function (float input) {
+    return activation_sigmoid(input);
+}
+
+float tanh_function (float input) {
+    return activation_tanh(input);
+}
@@ -1,6 +1,13 @@
+#ifndef HANDMADE_H
+#define HANDMADE_H
+
 void lstmCellSimple(float input, const float * input_weights, const float * hidden_weights,
                        const float * bias, float * hidden_layer, float * cell_states);
 
 float dense_nn(const float * input, const float * Weight, float bias);
 
 float sigmoid_function (float input);
+
+float tanh_function (float input);
+
+#endif //HANDMADE_H
@@ -0,0 +1,23 @@
+//
+// Model specific LSTM kernel, generated by the host codegen tool into kernel_generated.cpp.
+//
+// The weights of parameters.h are immediate constants, every loop is unrolled, zero weights
+// are dropped and unit weights folded, activations are inlined. Results are bit-identical
+// to lstmCellSimple/dense_nn on the same model. Dual prediction uses it when
+// GENERATED_KERNEL is defined; kernel_generated.cpp refuses to build against another model.
+//
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+/**
+ * lstmCellSimple with the weights of parameters.h
+ */
+void kernel_step(float input, float * hidden_layer, float * cell_states);
+
+/**
+ * dense_nn with the weights of parameters.h
+ */
+float kernel_dense(const float * hidden_layer);
+
+#endif //KERNEL_H
@@ -0,0 +1,39 @@
+//
+// Generated by the CPP codegen tool from parameters.h, do not edit.
+//
+// Kernel of model version 1, HUNIT 1, see kernel.h.
+//
+
+#ifdef GENERATED_KERNEL
+
+#include "activation.h"
+#include "kernel.h"
+#include "parameters.h"
+
+#if HUNIT != 1 || MODEL_VERSION != 1
+#error "kernel_generated.cpp was generated for another parameters.h, run codegen again"
+#endif
+
+#ifdef MODEL_SCALER_FOLDED
+#error "kernel_generated.cpp was generated for another parameters.h, run codegen again"
+#endif
+
+void kernel_step(float input, float * hidden_layer, float * cell_states) {
+    const float h0 = hidden_layer[0];
+
+    // Unit 0
+    const float input_gate0 = activation_sigmoid(0.118503056f * input - 0.62338078f * h0 + 0.886493683f);
+    const float forget_gate0 = activation_sigmoid(-0.276450574f * input + 0.132001564f * h0 + 1.0f);
+    const float cell_candidate0 = activation_sigmoid(0.0179580133f * input - 0.724248052f * h0 - 0.870543897f);
+    const float output_gate0 = activation_sigmoid(-1.26440692f * input - 0.263508439f * h0 + 0.522734582f);
+    cell_states[0] = forget_gate0 * cell_states[0] + input_gate0 * cell_candidate0;
+    const float new_hidden0 = output_gate0 * activation_tanh(cell_states[0]);
+
+    hidden_layer[0] = new_hidden0;
+}
+
+float kernel_dense(const float * hidden_layer) {
+    return -0.640433073f * hidden_layer[0] + 0.301314861f;
+}
+
+#endif //GENERATED_KERNEL
@@ -30,19 +30,41 @@ limitations under the License.
 
 // Personal functions LSTM By Hand
 #include "handmade.h"
+#include "dual_prediction.h"
+#include "node_sample.h"
+#include "conformance.h"
+#include "threshold.h"
+
+// Binary uplink format
+#include "payload.h"
+#include "uplink_batch.h"
 
 // Data for prediction
 #include "conso_data.h"
-#include "diff_scaled.h"
 // LSTM Parameters
 #include "parameters.h"
+#include "memory_plan.h"
+#include "node_config.h"
 
 using namespace events;
 
+/*
+ * The model must fit the target, see memory_plan.h and the budgets in mbed_app.json
+ */
+static_assert(sizeof(dual_prediction_t) == memory_plan_state_bytes(HUNIT),
+              "memory_plan.h is out of date with dual_prediction_t");
+static_assert(memory_plan_stack_bytes(HUNIT) <= MBED_CONF_APP_MAIN_STACK_SIZE,
+              "HUNIT does not fit the main stack of this target");
+static_assert(memory_plan_ram_bytes(HUNIT) <= MBED_CONF_APP_MODEL_RAM_BUDGET,
+              "HUNIT does not fit the RAM budget of this target");
+static_assert(memory_plan_flash_bytes(HUNIT, sizeof(conso_data)) <= MBED_CONF_APP_MODEL_FLASH_BUDGET,
+              "HUNIT does not fit the flash budget of this target");
+static_assert(EVENTS_EVENT_SIZE <= MEMORY_PLAN_EVENT_BYTES,
+              "memory_plan.h underestimates the events of the queue");
+
 // Max payload size can be LORAMAC_PHY_MAXPAYLOAD.
-// This example only communicates with much shorter messages (<30 bytes).
-// If longer messages are used, these buffers must be changed accordingly.
-uint8_t tx_buffer[30];
+// Uplinks are built in place in the batch buffer (see uplink_batch.h).
+// If longer downlinks are used, this buffer must be changed accordingly.
 uint8_t rx_buffer[30];
 
 /*
@@ -50,20 +72,20 @@ uint8_t rx_buffer[30];
  */
 #define THRESHOLD			0.3
 
-#define TX_INTERVAL             3000
-#define MINIMUM_CONFIDENCE      0.7
-
 /*
- * Sets up an application dependent transmission timer in ms. Used only when Duty Cycling is off for testing
+ * Threshold policy (see threshold.h): THRESHOLD_FIXED keeps THRESHOLD, THRESHOLD_BUDGET steers it so that
+ * THRESHOLD_TARGET of the samples are transmitted, THRESHOLD_ERROR keeps the 95th percentile of the
+ * reconstruction error under THRESHOLD_TARGET. THRESHOLD is the starting point of the adaptive policies.
  */
-#define TX_TIMER                        10000
+#define THRESHOLD_MODE                  THRESHOLD_FIXED
+#define THRESHOLD_TARGET                0.2
+
+#define MINIMUM_CONFIDENCE      0.7
 
 /**
- * Maximum number of events for the event queue.
- * 10 is the safe number for the stack events, however, if application
- * also uses the queue for whatever purposes, this number should be increased.
+ * Maximum number of events for the event queue, stack and application events (see memory_plan.h)
  */
-#define MAX_NUMBER_OF_EVENTS            10
+#define MAX_NUMBER_OF_EVENTS            MEMORY_PLAN_EVENTS
 
 /**
  * Maximum number of retries for CONFIRMED messages before giving up
@@ -99,9 +121,55 @@ static LoRaWANInterface lorawan(radio);
  */
 static lorawan_app_callbacks_t callbacks;
 
+/**
+ * Sampling tick, posted on ev_queue every SAMPLE_PERIOD
+ */
+static void sample_tick();
+
+/**
+ * Hands the frame waiting for a retransmission, else the pending batch, over to the LoRaWAN stack
+ */
+static void send_message();
+
+/**
+ * Tells whether send_message() has something to do
+ */
+static bool tx_due();
+
+/**
+ * Answers an uplink request of the Network Server
+ */
+static void send_requested_message();
+
 int inference_count = 0;
 
-static float first_send_message = true;
+// Sequence number of the next sample, shared with the server through uplinks
+static uint32_t sample_sequence = 0;
+
+// Model version is only announced once per boot
+static bool model_version_sent = false;
+
+// Transmission threshold, tuned on line unless THRESHOLD_MODE is THRESHOLD_FIXED
+static threshold_controller_t threshold;
+
+// Corrections waiting for transmission
+static uplink_batch_t batch;
+
+// Maximum payload at the data rate of the last uplink, worst case until the first one
+static int max_payload = eu868_max_payload(0);
+
+// A frame is in the hands of the stack
+static bool tx_in_flight = false;
+
+// Last frame accepted by the stack, kept until TX_DONE to be sent again if it fails.
+// The node has already advanced its series with these corrections, losing them would
+// leave the server out of step.
+static uint8_t tx_frame[BATCH_MAX_SIZE];
+static int tx_frame_length = 0;
+static int tx_attempts = 0;
+
+// Id of the queued duty cycle retry, 0 when none
+static int tx_retry_event = 0;
 
 /**
  * Entry point for application
@@ -111,6 +179,16 @@ int main(void) {
     // Keep track of how many inferences we have performed.
     inference_count = 0;
 
+    threshold_init(&threshold, THRESHOLD_MODE, THRESHOLD, THRESHOLD_TARGET);
+
+#ifdef CONFORMANCE_CHECK
+    // Must match the hash printed by the host conformance tool for the same model and threshold
+    int transmitted;
+    uint32_t hash = conformance_replay(conso_data, sizeof(conso_data) / sizeof(conso_data[0]),
+                                       THRESHOLD, &transmitted);
+    printf("\r\n Conformance hash %08lx, %d transmitted \r\n", (unsigned long) hash, transmitted);
+#endif
+
     // stores the status of a call to LoRaWAN protocol
     lorawan_status_t retcode;
 
@@ -162,138 +240,175 @@ int main(void) {
 }
 
 /**
- * Sends a message to the Network Server
+ * Returns the current meter reading. conso_data stands in for the sensor.
  */
-static void send_message()
+static float read_meter()
 {
-    // 0. Waiting between transmissions
-
-    printf("waiting 7 secs");
-    ThisThread::sleep_for(chrono::seconds(7));
-    printf("waited 7s");
-
-    // 0.5 Buffer allocation
-    // Boolean value corresponding to prediction status
-    static bool predict_nok;
-
-    // Previously transmitted value
-    static float previously_transmitted;
-
     // Index for reading conso_data file
     static int index_value;
 
-    // Counts the number of value skipped
-    static int skipped;
-
-    // Declaration of the differentiated variable and the scaled differentiated variable
-    static float x_diff;
-    static float x_diff_scaled;
-
-    // Declaration of the variable that stores the output of the LSTM
-    static float output_value;
-
-    // Loading data for tests if first time booting
-    if (first_send_message) {
-        first_send_message = false;
-        previously_transmitted = conso_data[0];
-        x_diff = 0;//load_data_Init();
-        predict_nok = true;
-        index_value = 0;
-        skipped = 0;
-        printf("\nError\n");
-    }
-
-    // 1. Scaler
-    float x_min = -363.16381836;
-    float x_max = 373.3527832;
-    float tx_min = 0.;
-    float tx_max = 0.9;
-    x_diff_scaled = diff_scaled_value[index_value];//(x_diff - x_min) / (x_max - x_min) * (tx_max - tx_min) + tx_min;
-            // Formula : X_scaled = (X-X_min)/(X_max-X_min) * (max-min) + min
-
-    // 2. Neural Network Prediction
-    // Dual prediction
-    // We position ourselves as the server and base prediction on previously transmitted value
-
-    printf("X_value = %i\n", (int) (x_diff_scaled*1000)); // Debugging info, reading x_diff_scaled
-
-    // LSTM Input is diffed and scaled data
-    // Other input are cell weights and states
-    lstmCellSimple(x_diff_scaled, lstm_cell_input_weights, lstm_cell_hidden_weights,
-		    lstm_cell_bias, lstm_cell_hidden_layer, lstm_cell_cell_states);
-
-    // Dense Neural network execution
-    output_value = dense_nn(lstm_cell_hidden_layer, dense_weights, dense_bias);
+    float value = conso_data[index_value];
+    index_value++;
+    if (index_value == (int) (sizeof(conso_data) / sizeof(conso_data[0]))) { index_value = 0;}
+    return value;
+}
 
-    printf("output = %i\n\n", (int) (output_value*1000)); // Debugging info, reading output value
+/**
+ * The batch cannot take the next correction, called by node_sample_step()
+ */
+static void flush_batch(void * context)
+{
+    (void) context;
+    send_message();
+}
 
-    // 3. Unscaling and coming back to real data
-    float y_diff_scaled = output_value; // Output value is y_diff_scaled
+/**
+ * Runs one prediction round and decides whether the measured value must be transmitted.
+ *
+ * The next tick is posted before any work is done so the sampling cadence does not drift
+ * with inference or radio time. Between two ticks the queue is empty and the MCU is free
+ * to enter deep sleep; the radio is only woken up through send_message().
+ */
+static void sample_tick()
+{
+    if (ev_queue.call_in(chrono::milliseconds(SAMPLE_PERIOD), sample_tick) == 0) {
+        // Sampling stops here, the queue is too small for the events in use
+        printf("\r\n sample_tick - Event queue full, sampling stopped \r\n");
+    }
 
-    float y_diff = (y_diff_scaled - tx_min) / (tx_max - tx_min) * (x_max - x_min) + x_min;
+    // Samples skipped since the last correction queued
+    static uint32_t skipped;
 
-    float y_val = y_diff + previously_transmitted;
+    // Model state and reconstructed series, mirrored by the server
+    static dual_prediction_t prediction;
 
-    // 4. Logging values
-    printf("Index Value %i\n", index_value);
-    printf("Value calculated is %i\n",(int) (y_val));
-    index_value++;
-    if (index_value == 718) { index_value = 0;}
-    printf("Actual data was : %i\n", (int)(conso_data[index_value]));
+    // 1. Reading the meter
+    float measured = read_meter();
 
-    // 5. Transmission decision
-    float difference_prediction = (y_val-conso_data[index_value])/(conso_data[index_value]); // Calculating accuracy
-    if (difference_prediction < 0) {
-            difference_prediction = - difference_prediction;
-    }
-    // Comparison with threshold
-    if (difference_prediction < THRESHOLD) {
-        predict_nok=false;
-        skipped++; // Increase amount of skipped value
-    } else {
-        predict_nok=true;
-        y_val=conso_data[index_value]; // If prediction is not ok, we transmit real value
+    // 2. to 5. Dual prediction, transmission decision and batching (see node_sample.h)
+    // We position ourselves as the server and base prediction on the reconstructed series.
+    // Corrections are appended to the current frame, the radio is only woken up
+    // when the frame is full or its oldest correction reaches BATCH_MAX_LATENCY
+    node_uplink_t uplink = {&batch, max_payload, !model_version_sent, &skipped, flush_batch, NULL};
+    node_sample_t sample;
+    if (node_sample_step(&prediction, sample_sequence, measured, threshold.threshold, &uplink, &sample) < 0) {
+        printf("send - Batch full, correction %d dropped\r\n", (int) sample_sequence);
     }
 
-    // 6. Logging the reference value
-    printf("Data to transmit : %i \n",(int)(y_val));
+    // 6. Logging values
+    if (sample_sequence != 0) {
+        inference_count++;
+        printf("Sample %i\n", (int) sample_sequence);
+        printf("Value calculated is %i\n",(int) (sample.forecast));
+        printf("Actual data was : %i\n", (int)(measured));
+        threshold_update(&threshold, sample.error, sample.transmitted);
+    }
+    printf("Data to transmit : %i \n",(int)(sample.value));
+    sample_sequence++;
 
-    // 7. Clean up after decision making
-    x_diff = conso_data[index_value] - conso_data[index_value -1];
-        // Declaring x_diff for the next round
-        // Here we declare based of conso_data value
+    if (tx_due()) {
+        send_message();
+    }
+}
 
-    previously_transmitted = conso_data[index_value];
-        // Previously transmitted should set to y_value instead of conso_data.
-        // Temporary forcing it for debugging
+/**
+ * A frame to transmit again, or a due batch
+ */
+static bool tx_due()
+{
+    return tx_frame_length > 0 || batch_due(&batch, sample_sequence, BATCH_MAX_LATENCY, max_payload);
+}
 
-    // 8. Transmission
+/**
+ * Reads the data rate used by the last uplink, ADR may have changed it
+ */
+static void update_max_payload()
+{
+    lorawan_tx_metadata metadata;
+    if (lorawan.get_tx_metadata(metadata) == LORAWAN_STATUS_OK) {
+        max_payload = eu868_max_payload(metadata.data_rate);
+    }
+}
 
-    uint16_t packet_len;
-    int16_t retcode;
+/**
+ * Duty cycle retry, posted by send_message()
+ */
+static void retry_message()
+{
+    tx_retry_event = 0;
+    send_message();
+}
 
-    if (predict_nok) {
-        packet_len = sprintf((char *) tx_buffer, "Transmitted Value is %d skip %d",
-            (int) (y_val), skipped);
-        retcode = lorawan.send(MBED_CONF_LORA_APP_PORT, tx_buffer, packet_len,
-                           MSG_UNCONFIRMED_FLAG);
+/**
+ * Sends a message to the Network Server
+ */
+static void send_message()
+{
+    // A failed frame goes first, the server needs the corrections in order
+    bool resend = tx_frame_length > 0;
+    if ((!resend && batch.count == 0) || tx_in_flight || tx_retry_event != 0) {
+        return;
+    }
 
-        if (retcode < 0) {
-            retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("send - Duty cycle violation\r\n")
-                : printf("send - Error code %d \r\n", retcode);
+    int16_t retcode = resend ? lorawan.send(MBED_CONF_LORA_APP_PORT, tx_frame, tx_frame_length, MSG_UNCONFIRMED_FLAG)
+                             : lorawan.send(MBED_CONF_LORA_APP_PORT, batch.buffer, batch.length, MSG_UNCONFIRMED_FLAG);
 
-            if (retcode == LORAWAN_STATUS_WOULD_BLOCK) {
-                // retry in 3 secs
-                ev_queue.call_in(10000, send_message);
+    if (retcode < 0) {
+        retcode == LORAWAN_STATUS_WOULD_BLOCK ? printf("send - Duty cycle violation\r\n")
+            : printf("send - Error code %d \r\n", retcode);
+
+        if (retcode == LORAWAN_STATUS_WOULD_BLOCK) {
+            // Retry when the duty cycle window opens, corrections keep piling up in the batch meanwhile
+            int backoff = 0;
+            if (lorawan.get_backoff_metadata(backoff) != LORAWAN_STATUS_OK || backoff <= 0) {
+                backoff = TX_RETRY_DELAY;
+            }
+            tx_retry_event = ev_queue.call_in(chrono::milliseconds(backoff), retry_message);
+            if (tx_retry_event == 0) {
+                printf("send - Event queue full, retry left to the next sample\r\n");
             }
-            return;
         }
-        printf("%d bytes scheduled for transmission \r\n", retcode);
-        memset(tx_buffer, 0, sizeof(tx_buffer));
-        skipped = 0;
+        return;
+    }
+
+    if (resend) {
+        printf("%d bytes scheduled for retransmission, attempt %d \r\n", retcode, tx_attempts + 1);
     } else {
+        printf("%d bytes (%d corrections) scheduled for transmission \r\n", retcode, batch.count);
+        // Kept until TX_DONE, new corrections start the next frame meanwhile
+        memcpy(tx_frame, batch.buffer, batch.length);
+        tx_frame_length = batch.length;
+        tx_attempts = 0;
+        batch_reset(&batch);
+        model_version_sent = true;
+    }
+    tx_attempts++;
+    tx_in_flight = true;
+}
+
+/**
+ * The pending batch goes out even if it is not due yet. With nothing pending, an empty frame
+ * still gives the Network Server its uplink, and its MAC answers with it.
+ */
+static void send_requested_message()
+{
+    if (tx_frame_length > 0 || batch.count > 0) {
         send_message();
+        return;
     }
+    if (tx_in_flight || tx_retry_event != 0) {
+        // An uplink is already on its way
+        return;
+    }
+
+    int16_t retcode = lorawan.send(MBED_CONF_LORA_APP_PORT, tx_frame, 0, MSG_UNCONFIRMED_FLAG);
+    if (retcode < 0) {
+        // The Network Server asks again on a later downlink
+        printf("send - Empty frame not sent, error code %d \r\n", retcode);
+        return;
+    }
+    printf("Empty frame scheduled for transmission \r\n");
+    tx_in_flight = true;
 }
 
 /**
@@ -327,12 +442,7 @@ static void lora_event_handler(lorawan_event_t event)
     switch (event) {
         case CONNECTED:
             printf("\r\n Connection - Successful \r\n");
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
-                send_message();
-            } else {
-                ev_queue.call_every(TX_TIMER, send_message);
-            }
-
+            ev_queue.call(sample_tick);
             break;
         case DISCONNECTED:
             ev_queue.break_dispatch();
@@ -340,7 +450,11 @@ static void lora_event_handler(lorawan_event_t event)
             break;
         case TX_DONE:
             printf("\r\n Message Sent to Network Server \r\n");
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
+            tx_in_flight = false;
+            tx_frame_length = 0;
+            update_max_payload();
+            // The batch may have filled up while the radio was busy
+            if (tx_due()) {
                 send_message();
             }
             break;
@@ -349,8 +463,12 @@ static void lora_event_handler(lorawan_event_t event)
         case TX_CRYPTO_ERROR:
         case TX_SCHEDULING_ERROR:
             printf("\r\n Transmission Error - EventCode = %d \r\n", event);
-            // try again
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
+            tx_in_flight = false;
+            if (tx_attempts >= TX_MAX_ATTEMPTS) {
+                printf("\r\n Frame given up after %d attempts \r\n", tx_attempts);
+                tx_frame_length = 0;
+            }
+            if (tx_due()) {
                 send_message();
             }
             break;
@@ -367,85 +485,11 @@ static void lora_event_handler(lorawan_event_t event)
             break;
         case UPLINK_REQUIRED:
             printf("\r\n Uplink required by NS \r\n");
-            if (MBED_CONF_LORA_DUTY_CYCLE_ON) {
-                send_message();
-            }
+            send_requested_message();
             break;
         default:
             MBED_ASSERT("Unknown Event");
     }
 }
 
-void lstmCellSimple(float input, const float * input_weights, const float * hidden_weights,
-		const float * bias, float * hidden_layer, float * cell_states) {
-    /**
-     * input - float
-     * input_weight - float array (4*HUNIT) - Weights W_i, W_f, W_c, W_o
-     * hidden_weights - float array (4*HUNIT*HUNIT) - Weights U_i, U_f, U_c, U_o
-     * bias - float array (4*HUNIT) - Bias B_i, B_f, B_c, B_o
-     * hidden_layer - float array (4*HUNIT) - Outputs h
-     * cell_states - float array (4*HUNIT) - Cell states
-     * HUNIT - size of hidden layer
-     */
-
-    float new_hidden_layer[HUNIT];
-    float new_cell_states[HUNIT];
-
-    float input_gate[HUNIT];
-    float forget_gate[HUNIT];
-    float cell_candidate[HUNIT];
-    float output_gate[HUNIT];
-
-    for (int i = 0; i < HUNIT; ++i) {
-        input_gate[i] = input_weights[0 * HUNIT + i] * input;
-        forget_gate[i] = input_weights[1 * HUNIT + i] * input;
-        cell_candidate[i] = input_weights[2 * HUNIT + i] * input;
-        output_gate[i] = input_weights[3 * HUNIT + i] * input;
-
-        for (int j = 0; j < HUNIT; ++j) {
-            input_gate[i] += hidden_weights[(0 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
-            forget_gate[i] += hidden_weights[(1 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
-            cell_candidate[i] += hidden_weights[(2 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
-            output_gate[i] += hidden_weights[(3 * HUNIT + i) * HUNIT + j] * hidden_layer[j];
-        }
-
-        input_gate[i] += bias[0 * HUNIT + i];
-        forget_gate[i] += bias[1 * HUNIT + i];
-        cell_candidate[i] += bias[2 * HUNIT + i];
-        output_gate[i] += bias[3 * HUNIT + i];
-
-        input_gate[i] = sigmoid_function(input_gate[i]);
-        forget_gate[i] = sigmoid_function(forget_gate[i]);
-        cell_candidate[i] = sigmoid_function(cell_candidate[i]);
-        output_gate[i] = sigmoid_function(output_gate[i]);
-    }
-
-    for (int i = 0; i < HUNIT; ++i) {
-
-        new_cell_states[i] = forget_gate[i] * cell_states [i] + input_gate[i] * cell_candidate[i];
-        new_hidden_layer[i] = output_gate[i] * tanh(new_cell_states[i]);
-
-    }
-
-    for (int i = 0; i < HUNIT; ++i) {
-	    hidden_layer[i] = new_hidden_layer[i];
-	    cell_states[i] = new_cell_states[i];
-    }
-
-    return;
-}
-
-
-float dense_nn(const float * input, const float * Weight, float bias) {
-    float output = 0;
-    for (int i = 0; i < HUNIT; ++i) {
-        output += input[i] * Weight[i];
-    }
-    output += bias;
-    return output;
-}
-
-float sigmoid_function (float input) {
-    return 1/(1+(exp(-input)));
-}
 //EOF
@@ -0,0 +1,107 @@
+//
+// Static memory plan of the prediction application for a hidden layer of hunit units.
+//
+// Counts what the application adds on top of Mbed OS, the LoRaWAN stack and the radio driver:
+//  - flash: const weights, initial states, scaler and the conso_data table,
+//  - static RAM: the state kept between samples (dual prediction, threshold, batch, frame in
+//    flight, flags) and the buffer of the event queue,
+//  - main stack: the deepest call of a sample, sample_tick -> node_sample_step ->
+//    dual_prediction_predict -> lstmCellSimple, or sample_tick -> send_message -> lorawan.send
+//    into LoRaMac, whichever is deeper, plus printf. The event queue is dispatched on the main
+//    thread, so the LoRaWAN stack runs there too.
+// Model dependent terms are exact, the frame, stdio, LoRaWAN and event reserves are estimates
+// for Cortex-M GCC_ARM builds. The firmware checks them at compile time against the budgets of its target
+// in mbed_app.json, the host memplan tool prints them for any model file.
+//
+
+#ifndef MEMORY_PLAN_H
+#define MEMORY_PLAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "preprocess.h"
+#include "threshold.h"
+#include "uplink_batch.h"
+
+// Saved registers, locals and call overhead of sample_tick, node_sample_step,
+// dual_prediction_predict, lstmCellSimple and dense_nn, generous for -Os Cortex-M0+ builds
+#define MEMORY_PLAN_FRAMES_BYTES        256
+
+// printf from sample_tick, minimal-printf with its buffers
+#define MEMORY_PLAN_STDIO_BYTES         384
+
+// main.cpp flags, counters and rx_buffer
+#define MEMORY_PLAN_APP_RAM_BYTES       64
+
+// lorawan.send down to LoRaMac: frame building, the AES-CMAC of the MIC with its mbedtls cipher
+// and AES key schedule contexts, and the radio driver's SPI writes
+#define MEMORY_PLAN_LORAWAN_STACK_BYTES 640
+
+/**
+ * Events of the queue shared with the LoRaWAN stack. 10 is the safe number for the stack
+ * events, the application adds the next sample_tick, posted while the current one still
+ * holds its own event, and the duty cycle retry of send_message().
+ */
+#define MEMORY_PLAN_STACK_EVENTS        10
+#define MEMORY_PLAN_APP_EVENTS          3
+#define MEMORY_PLAN_EVENTS              (MEMORY_PLAN_STACK_EVENTS + MEMORY_PLAN_APP_EVENTS)
+
+// EVENTS_EVENT_SIZE on 32 bit targets (equeue_event and an mbed::Callback), checked by the firmware
+#define MEMORY_PLAN_EVENT_BYTES         64
+
+/**
+ * Weights, initial states and scaler of parameters.h, all const
+ */
+constexpr size_t memory_plan_model_flash_bytes(size_t hunit) {
+    return (4 * hunit + 4 * hunit * hunit + 4 * hunit + 2 * hunit + hunit + 1) * sizeof(float) + sizeof(scaler_t);
+}
+
+/**
+ * sizeof(dual_prediction_t) for hunit, checked against the real one by the firmware
+ */
+constexpr size_t memory_plan_state_bytes(size_t hunit) {
+    return 2 * hunit * sizeof(float) + sizeof(scaler_t) + sizeof(differencer_t) + sizeof(float) + sizeof(uint32_t)
+#ifdef ONLINE_DENSE
+           + (hunit + 2) * sizeof(float)
+#endif
+#ifdef ANOMALY_GATE
+           + 2 * sizeof(float) + 2 * sizeof(uint32_t)  // holding is padded to 4 bytes
+#endif
+           ;
+}
+
+/**
+ * lstmCellSimple keeps a single float[HUNIT], the gates live in registers
+ */
+constexpr size_t memory_plan_cell_stack_bytes(size_t hunit) {
+    return hunit * sizeof(float);
+}
+
+/**
+ * sample_tick is done with the model before it calls send_message(), the deeper of the two
+ * paths counts
+ */
+constexpr size_t memory_plan_stack_bytes(size_t hunit) {
+    return (memory_plan_cell_stack_bytes(hunit) > MEMORY_PLAN_LORAWAN_STACK_BYTES
+            ? memory_plan_cell_stack_bytes(hunit) : MEMORY_PLAN_LORAWAN_STACK_BYTES)
+           + MEMORY_PLAN_FRAMES_BYTES + MEMORY_PLAN_STDIO_BYTES;
+}
+
+/**
+ * The batch being filled, the copy of the frame in flight and the event queue come on top of
+ * the state
+ */
+constexpr size_t memory_plan_ram_bytes(size_t hunit) {
+    return memory_plan_state_bytes(hunit) + sizeof(threshold_controller_t) + sizeof(uplink_batch_t)
+           + BATCH_MAX_SIZE + MEMORY_PLAN_EVENTS * MEMORY_PLAN_EVENT_BYTES + MEMORY_PLAN_APP_RAM_BYTES;
+}
+
+/**
+ * table_bytes - sizeof(conso_data), the stand-in for the sensor
+ */
+constexpr size_t memory_plan_flash_bytes(size_t hunit, size_t table_bytes) {
+    return memory_plan_model_flash_bytes(hunit) + table_bytes;
+}
+
+#endif //MEMORY_PLAN_H
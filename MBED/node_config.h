@@ -0,0 +1,33 @@
+//
+// Timing of the node's sampling and transmission loop.
+//
+// Shared by the firmware (main.cpp) and the host tools that replay its control flow (cost,
+// airtime_sim, fleet_sim, stream_sim), so that a simulation runs the node as it ships.
+//
+
+#ifndef NODE_CONFIG_H
+#define NODE_CONFIG_H
+
+/*
+ * Sampling period in ms. Each tick reads one meter value and runs one inference.
+ */
+#define SAMPLE_PERIOD                   7000
+
+/*
+ * Delay in ms before retrying a transmission refused by the duty cycle, when the stack
+ * does not report its backoff
+ */
+#define TX_RETRY_DELAY                  10000
+
+/*
+ * Number of samples a correction may wait in the batch before the frame is sent
+ */
+#define BATCH_MAX_LATENCY               8
+
+/*
+ * Transmissions of a frame the stack reported as failed (TX_ERROR, TX_TIMEOUT...) before
+ * its corrections are given up, the server then sees the gap through the skipped counts
+ */
+#define TX_MAX_ATTEMPTS                 3
+
+#endif //NODE_CONFIG_H
@@ -0,0 +1,81 @@
+//
+// One sample of the node: forecast, transmission decision, queuing of the correction and
+// update of the reconstructed series.
+//
+
+#include "deterministic.h"
+#include "node_sample.h"
+
+void node_sample_decide(node_sample_t * sample, bool first, float measured, float forecast, float threshold) {
+    sample->measured = measured;
+    sample->forecast = first ? measured : forecast;
+    sample->error = 0;
+    sample->transmitted = true;
+
+    if (!first) {
+        sample->error = (forecast - measured) / measured;
+        if (sample->error < 0) {
+            sample->error = - sample->error;
+        }
+        sample->transmitted = !(sample->error < threshold);
+    }
+
+    sample->quantized = payload_quantize(measured);
+    // The server holds the transmitted fixed point value, not the raw reading
+    sample->value = sample->transmitted ? payload_dequantize(sample->quantized) : sample->forecast;
+}
+
+/**
+ * Appends the correction of sample to the batch, flushing a full batch once
+ * Returns 0, -1 if it still does not fit
+ */
+static int node_sample_queue(const node_uplink_t * uplink, uint32_t sequence, const node_sample_t * sample) {
+    uplink_t record;
+    record.sequence = sequence;
+    record.skipped = *uplink->skipped;
+    record.value = sample->quantized;
+    record.model_version = MODEL_VERSION;
+    record.has_model_version = uplink->announce_model;
+
+    if (batch_add(uplink->batch, &record, uplink->max_payload) < 0) {
+        // Frame full: push it out and start a new one
+        uplink->flush(uplink->context);
+        if (batch_add(uplink->batch, &record, uplink->max_payload) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int node_sample_send(const node_uplink_t * uplink, uint32_t sequence, node_sample_t * sample) {
+    int status = sample->transmitted ? 1 : 0;
+    if (sample->transmitted && node_sample_queue(uplink, sequence, sample) < 0) {
+        // The server will never see this correction, keep the forecast like it will
+        status = -1;
+        sample->transmitted = false;
+        sample->value = sample->forecast;
+    }
+    *uplink->skipped = sample->transmitted ? 0 : *uplink->skipped + 1;
+    return status;
+}
+
+int node_sample_step(dual_prediction_t * prediction, uint32_t sequence, float measured, float threshold,
+                     const node_uplink_t * uplink, node_sample_t * sample) {
+    bool first = sequence == 0;
+    float forecast = first ? measured : dual_prediction_predict(prediction);
+    node_sample_decide(sample, first, measured, forecast, threshold);
+
+    int status = sample->transmitted ? 1 : 0;
+    if (uplink) {
+        status = node_sample_send(uplink, sequence, sample);
+    }
+
+    if (first) {
+        dual_prediction_init(prediction, sample->value, sequence);
+    } else if (sample->transmitted) {
+        dual_prediction_correct(prediction, sample->value);
+    } else {
+        dual_prediction_commit(prediction, sample->value);
+    }
+    return status;
+}
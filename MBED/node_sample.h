@@ -0,0 +1,70 @@
+//
+// One sample of the node: forecast, transmission decision, queuing of the correction and
+// update of the reconstructed series.
+//
+// This is sample_tick() of main.cpp without the meter, the logs and the radio, shared with
+// every host tool replaying a node so that they all take the firmware's decisions. Tools
+// running their own kernel (batched runtime, traced or approximate kernels) share the
+// decision, node_sample_decide, and the uplink half, node_sample_send.
+//
+
+#ifndef NODE_SAMPLE_H
+#define NODE_SAMPLE_H
+
+#include <stdint.h>
+
+#include "dual_prediction.h"
+#include "payload.h"
+#include "uplink_batch.h"
+
+struct node_sample_t {
+    float measured;
+    float forecast;             // the measured value on the first sample
+    float error;                // relative error of the forecast, 0 on the first sample
+    int32_t quantized;          // fixed point value transmitted
+    bool transmitted;
+    float value;                // reconstructed value, what the server holds for the sample
+};
+
+/**
+ * Batch the node queues its corrections in
+ */
+struct node_uplink_t {
+    uplink_batch_t * batch;
+    int max_payload;                    // at the current data rate
+    bool announce_model;                // the record carries MODEL_VERSION
+    uint32_t * skipped;                 // samples since the last correction queued, kept by the caller
+    void (*flush)(void * context);      // sends the full batch if it can, called once before a drop
+    void * context;
+};
+
+/**
+ * Transmission decision: the first sample is always transmitted, later ones when the relative
+ * error of their forecast is not under threshold (NaN included). A transmitted sample is
+ * reconstructed from its fixed point value, a skipped one is its forecast.
+ * first - sample 0 of the series, nothing to forecast it from
+ * forecast - ignored on the first sample
+ */
+void node_sample_decide(node_sample_t * sample, bool first, float measured, float forecast, float threshold);
+
+/**
+ * Queues the correction of a decided sample and keeps the skip counter, as node_sample_step
+ * does after its forecast
+ * Returns as node_sample_step
+ */
+int node_sample_send(const node_uplink_t * uplink, uint32_t sequence, node_sample_t * sample);
+
+/**
+ * Runs one sample through the node
+ * prediction - dual prediction state, initialised on sequence 0
+ * sequence - sequence of the sample, 0 starts the series
+ * threshold - relative error above which the sample is transmitted
+ * uplink - batch the correction goes to, null when the caller queues it and never drops it
+ * sample - decision and reconstructed value
+ * Returns 1 when the sample is transmitted, 0 when it is skipped, -1 when the batch could not
+ * take its correction: the sample is then reconstructed from its forecast, as the server will.
+ */
+int node_sample_step(dual_prediction_t * prediction, uint32_t sequence, float measured, float threshold,
+                     const node_uplink_t * uplink, node_sample_t * sample);
+
+#endif //NODE_SAMPLE_H
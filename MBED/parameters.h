@@ -7,7 +7,8 @@
 
 #define HUNIT 1
 
-#endif //CPP_PARAMETERS_H
+// Identifies this set of weights in uplinks, bump on every export
+#define MODEL_VERSION 1
 
 const int hunit = HUNIT;
 
@@ -17,9 +18,17 @@ const float lstm_cell_hidden_weights[4 * HUNIT * HUNIT] = {-0.6233807802200317,
 
 const float lstm_cell_bias[4 * HUNIT] = {0.8864936828613281, 1.0, -0.870543897151947, 0.5227345824241638};
 
-float lstm_cell_hidden_layer[HUNIT] = {-0.4616917371749878};
-float lstm_cell_cell_states[HUNIT] = {-1.2524135112762451};
+// Initial states, copied into each dual prediction state
+const float lstm_cell_hidden_layer[HUNIT] = {-0.4616917371749878};
+const float lstm_cell_cell_states[HUNIT] = {-1.2524135112762451};
 
 const float dense_weights[HUNIT] = {-0.6404330730438232};
 const float dense_bias = 0.3013148605823517;
 
+// Scaler fitted on the differenced training set, MinMaxScaler(feature_range=(0, 0.9))
+const float scaler_x_min = -363.16381836;
+const float scaler_x_max = 373.3527832;
+const float scaler_tx_min = 0.;
+const float scaler_tx_max = 0.9;
+
+#endif //CPP_PARAMETERS_H
@@ -0,0 +1,165 @@
+//
+// Compact binary uplink payload, shared by the node and the host decoder.
+//
+
+#include "deterministic.h"
+#include "payload.h"
+
+static int put_varint(uint32_t value, uint8_t * buffer, int size) {
+    int length = 0;
+    do {
+        if (length == size) {
+            return -1;
+        }
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        buffer[length++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return length;
+}
+
+static int get_varint(const uint8_t * buffer, int length, uint32_t * value) {
+    uint32_t result = 0;
+    for (int i = 0; i < length && i < 5; ++i) {
+        result |= (uint32_t) (buffer[i] & 0x7f) << (7 * i);
+        if (!(buffer[i] & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+static uint32_t zigzag_encode(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value) {
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+int32_t payload_quantize(float value) {
+    float scaled = value * PAYLOAD_VALUE_SCALE;
+    return (int32_t) (scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+float payload_dequantize(int32_t value) {
+    return (float) value / PAYLOAD_VALUE_SCALE;
+}
+
+int payload_encode(const uplink_t * uplink, uint8_t * buffer, int size) {
+    int length = 0;
+    int written;
+
+    if (size < 1) {
+        return -1;
+    }
+    buffer[length++] = (PAYLOAD_VERSION << 6) | (uplink->has_model_version ? PAYLOAD_FLAG_MODEL_VERSION : 0);
+
+    written = put_varint(uplink->sequence, buffer + length, size - length);
+    if (written < 0) { return -1; }
+    length += written;
+
+    if (uplink->has_model_version) {
+        if (length == size) { return -1; }
+        buffer[length++] = uplink->model_version;
+    }
+
+    written = put_varint(uplink->skipped, buffer + length, size - length);
+    if (written < 0) { return -1; }
+    length += written;
+
+    written = put_varint(zigzag_encode(uplink->value), buffer + length, size - length);
+    if (written < 0) { return -1; }
+    length += written;
+
+    return length;
+}
+
+int payload_decode(const uint8_t * buffer, int length, uplink_t * uplink) {
+    int position = 0;
+    int read;
+    uint32_t raw;
+
+    if (length < 1 || (buffer[0] >> 6) != PAYLOAD_VERSION) {
+        return -1;
+    }
+    uplink->has_model_version = (buffer[position++] & PAYLOAD_FLAG_MODEL_VERSION) != 0;
+
+    read = get_varint(buffer + position, length - position, &uplink->sequence);
+    if (read < 0) { return -1; }
+    position += read;
+
+    uplink->model_version = 0;
+    if (uplink->has_model_version) {
+        if (position == length) { return -1; }
+        uplink->model_version = buffer[position++];
+    }
+
+    read = get_varint(buffer + position, length - position, &uplink->skipped);
+    if (read < 0) { return -1; }
+    position += read;
+
+    read = get_varint(buffer + position, length - position, &raw);
+    if (read < 0) { return -1; }
+    position += read;
+    uplink->value = zigzag_decode(raw);
+
+    return position;
+}
+
+int payload_encode_next(const uplink_t * previous, const uplink_t * uplink, uint8_t * buffer, int size) {
+    int length = 0;
+    int written;
+
+    written = put_varint(uplink->skipped, buffer, size);
+    if (written < 0) { return -1; }
+    length += written;
+
+    written = put_varint(zigzag_encode(uplink->value - previous->value), buffer + length, size - length);
+    if (written < 0) { return -1; }
+    length += written;
+
+    return length;
+}
+
+int payload_decode_batch(const uint8_t * buffer, int length, uplink_t * records, int max_records) {
+    int count = 0;
+    int position;
+    int read;
+    uint32_t raw;
+
+    if (max_records < 1) {
+        return -1;
+    }
+    position = payload_decode(buffer, length, &records[0]);
+    if (position < 0) {
+        return -1;
+    }
+    count = 1;
+
+    while (position < length) {
+        const uplink_t * previous = &records[count - 1];
+        uplink_t * record = &records[count];
+
+        if (count == max_records) {
+            return -1;
+        }
+
+        read = get_varint(buffer + position, length - position, &record->skipped);
+        if (read < 0) { return -1; }
+        position += read;
+
+        read = get_varint(buffer + position, length - position, &raw);
+        if (read < 0) { return -1; }
+        position += read;
+
+        record->sequence = previous->sequence + record->skipped + 1;
+        record->value = previous->value + zigzag_decode(raw);
+        record->model_version = previous->model_version;
+        record->has_model_version = previous->has_model_version;
+        count++;
+    }
+
+    return count;
+}
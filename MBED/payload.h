@@ -0,0 +1,95 @@
+//
+// Compact binary uplink payload, shared by the node and the host decoder.
+//
+
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <stdint.h>
+
+/*
+ * Frame layout (all integers are LEB128 varints, little end first):
+ *
+ *   header        - 1 byte : bits 7..6 format version, bit 0 model version present
+ *   sequence      - varint : index of the sample on the node
+ *   model_version - 1 byte : only when the header flag is set
+ *   skipped       - varint : number of samples skipped since the previous uplink
+ *   value         - zigzag varint : value * PAYLOAD_VALUE_SCALE, rounded
+ *
+ * Further records of the same frame only carry two varints:
+ *
+ *   skipped       - varint : samples skipped since the previous record, which also gives
+ *                            its sequence (previous sequence + skipped + 1)
+ *   value delta   - zigzag varint : difference with the previous record's value
+ *
+ * A typical single record uplink is 5 to 7 bytes instead of the ~30 bytes of the former
+ * text message, each additional record costs 2 to 4 bytes.
+ */
+#define PAYLOAD_VERSION                 1
+#define PAYLOAD_FLAG_MODEL_VERSION      0x01
+
+// Fixed point resolution of transmitted values (1/100 of a unit)
+#define PAYLOAD_VALUE_SCALE             100
+
+// Largest frame payload_encode can produce
+#define PAYLOAD_MAX_SIZE                17
+
+// Largest record payload_encode_next can produce
+#define PAYLOAD_RECORD_MAX_SIZE         10
+
+struct uplink_t {
+    uint32_t sequence;
+    uint32_t skipped;
+    int32_t value;              // fixed point, see payload_quantize
+    uint8_t model_version;
+    bool has_model_version;
+};
+
+/**
+ * Converts a measured value to its transmitted fixed point representation
+ */
+int32_t payload_quantize(float value);
+
+/**
+ * Converts a transmitted fixed point value back to a float
+ */
+float payload_dequantize(int32_t value);
+
+/**
+ * uplink - message to encode
+ * buffer - output buffer
+ * size - size of buffer
+ * Returns the number of bytes written, -1 if buffer is too small
+ */
+int payload_encode(const uplink_t * uplink, uint8_t * buffer, int size);
+
+/**
+ * Appends a record after previous in a frame started by payload_encode.
+ * uplink->sequence must be previous->sequence + uplink->skipped + 1.
+ * previous - last record already in the frame
+ * uplink - record to append
+ * buffer - position right after the last record
+ * size - space left in the frame
+ * Returns the number of bytes written, -1 if buffer is too small
+ */
+int payload_encode_next(const uplink_t * previous, const uplink_t * uplink, uint8_t * buffer, int size);
+
+/**
+ * buffer - received frame
+ * length - frame length
+ * uplink - decoded message
+ * Returns the number of bytes consumed, -1 on malformed or unsupported frame
+ */
+int payload_decode(const uint8_t * buffer, int length, uplink_t * uplink);
+
+/**
+ * Decodes every record of a frame. Records after the first inherit its model version.
+ * buffer - received frame
+ * length - frame length
+ * records - decoded records, in sequence order
+ * max_records - size of records
+ * Returns the number of records, -1 on malformed frame or if records is too small
+ */
+int payload_decode_batch(const uint8_t * buffer, int length, uplink_t * records, int max_records);
+
+#endif //PAYLOAD_H
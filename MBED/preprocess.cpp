@@ -0,0 +1,56 @@
+//
+// Streaming preprocessing: differencing and min-max scaling, as done by the training notebooks.
+//
+
+#include "deterministic.h"
+#include "parameters.h"
+#include "preprocess.h"
+
+scaler_t model_scaler() {
+    scaler_t scaler;
+    scaler.x_min = scaler_x_min;
+    scaler.x_max = scaler_x_max;
+    scaler.tx_min = scaler_tx_min;
+    scaler.tx_max = scaler_tx_max;
+    return scaler;
+}
+
+float scale_value(const scaler_t * scaler, float x) {
+    return (x - scaler->x_min) / (scaler->x_max - scaler->x_min) * (scaler->tx_max - scaler->tx_min) + scaler->tx_min;
+}
+
+float invert_scale_value(const scaler_t * scaler, float y) {
+    return (y - scaler->tx_min) / (scaler->tx_max - scaler->tx_min) * (scaler->x_max - scaler->x_min) + scaler->x_min;
+}
+
+void difference_init(differencer_t * differencer, float value) {
+    differencer->previous = value;
+}
+
+float difference_push(differencer_t * differencer, float value) {
+    float diff = value - differencer->previous;
+    differencer->previous = value;
+    return diff;
+}
+
+float invert_difference(const differencer_t * differencer, float diff) {
+    return diff + differencer->previous;
+}
+
+void scale_series(const scaler_t * scaler, const float * input, float * output, int length) {
+    for (int i = 0; i < length; ++i) {
+        output[i] = scale_value(scaler, input[i]);
+    }
+}
+
+void invert_scale_series(const scaler_t * scaler, const float * input, float * output, int length) {
+    for (int i = 0; i < length; ++i) {
+        output[i] = invert_scale_value(scaler, input[i]);
+    }
+}
+
+void difference_series(const float * input, float * output, int length) {
+    for (int i = 0; i + 1 < length; ++i) {
+        output[i] = input[i + 1] - input[i];
+    }
+}
@@ -0,0 +1,60 @@
+//
+// Streaming preprocessing: differencing and min-max scaling, as done by the training notebooks.
+//
+// The node runs it sample by sample on live readings, the host tools run the series
+// variants over whole buffers. Both use the same expressions, hence the same bits.
+//
+
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+/*
+ * Min-max scaler, sklearn MinMaxScaler semantics
+ * Formula : X_scaled = (X-X_min)/(X_max-X_min) * (max-min) + min
+ */
+struct scaler_t {
+    float x_min;
+    float x_max;
+    float tx_min;
+    float tx_max;
+};
+
+struct differencer_t {
+    float previous;             // last value pushed
+};
+
+/**
+ * Scaler stored in parameters.h alongside the weights
+ */
+scaler_t model_scaler();
+
+float scale_value(const scaler_t * scaler, float x);
+
+float invert_scale_value(const scaler_t * scaler, float y);
+
+/**
+ * Starts a differenced series at value
+ */
+void difference_init(differencer_t * differencer, float value);
+
+/**
+ * Returns value minus the previously pushed value
+ */
+float difference_push(differencer_t * differencer, float value);
+
+/**
+ * Inverse of difference_push: previous value plus a difference
+ */
+float invert_difference(const differencer_t * differencer, float diff);
+
+/**
+ * Whole series versions. output[i] = input[i+1] - input[i] for difference_series,
+ * which writes length - 1 values.
+ */
+void scale_series(const scaler_t * scaler, const float * input, float * output, int length);
+
+void invert_scale_series(const scaler_t * scaler, const float * input, float * output, int length);
+
+void difference_series(const float * input, float * output, int length);
+
+#endif //PREPROCESS_H
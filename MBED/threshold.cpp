@@ -0,0 +1,65 @@
+//
+// Adaptive transmission threshold.
+//
+
+#include "threshold.h"
+
+// Quantile of the reconstruction error bounded in THRESHOLD_ERROR mode
+#define THRESHOLD_ERROR_QUANTILE    0.95f
+
+// Smallest step of the quantile estimate, relative to a 1% error
+#define QUANTILE_MIN_SCALE          0.01f
+
+void quantile_init(quantile_t * quantile, float q, float initial, float rate) {
+    quantile->q = q;
+    quantile->estimate = initial;
+    quantile->rate = rate;
+}
+
+void quantile_update(quantile_t * quantile, float x) {
+    float scale = quantile->estimate > QUANTILE_MIN_SCALE ? quantile->estimate : QUANTILE_MIN_SCALE;
+    float step = quantile->rate * scale;
+    if (x >= quantile->estimate) {
+        quantile->estimate += step * quantile->q;
+    } else {
+        quantile->estimate -= step * (1 - quantile->q);
+    }
+}
+
+void threshold_init(threshold_controller_t * controller, threshold_mode_t mode, float initial, float target) {
+    controller->mode = mode;
+    controller->threshold = initial;
+    controller->target = target;
+    controller->gain = 0.05f;
+    controller->min_threshold = 0.005f;
+    controller->max_threshold = 2.0f;
+    quantile_init(&controller->error, THRESHOLD_ERROR_QUANTILE, target, 0.05f);
+}
+
+void threshold_update(threshold_controller_t * controller, float relative_error, bool transmitted) {
+    float correction;
+
+    switch (controller->mode) {
+        case THRESHOLD_BUDGET:
+            // Settles where the long run transmitted fraction equals the target
+            correction = (transmitted ? 1.0f : 0.0f) - controller->target;
+            break;
+        case THRESHOLD_ERROR:
+            // Raise the threshold while the error quantile stays under the bound
+            quantile_update(&controller->error, transmitted ? 0.0f : relative_error);
+            correction = (controller->target - controller->error.estimate) / controller->target;
+            if (correction > 1.0f) { correction = 1.0f; }
+            if (correction < -1.0f) { correction = -1.0f; }
+            break;
+        default:
+            return;
+    }
+
+    controller->threshold *= 1.0f + controller->gain * correction;
+    if (controller->threshold < controller->min_threshold) {
+        controller->threshold = controller->min_threshold;
+    }
+    if (controller->threshold > controller->max_threshold) {
+        controller->threshold = controller->max_threshold;
+    }
+}
@@ -0,0 +1,60 @@
+//
+// Adaptive transmission threshold.
+//
+// The node transmits a sample when the relative error of its forecast reaches the threshold.
+// Instead of a compile-time constant, the controller can steer the threshold towards
+//  - THRESHOLD_BUDGET: a target fraction of samples transmitted, or
+//  - THRESHOLD_ERROR: a target bound on a running quantile of the reconstruction error.
+// Only the node needs it, the server just applies whatever corrections it receives.
+//
+
+#ifndef THRESHOLD_H
+#define THRESHOLD_H
+
+enum threshold_mode_t {
+    THRESHOLD_FIXED,
+    THRESHOLD_BUDGET,
+    THRESHOLD_ERROR
+};
+
+/*
+ * Running quantile with O(1) memory (stochastic approximation): the estimate moves up by
+ * step*q on samples above it and down by step*(1-q) below it, settling where a fraction q
+ * of the samples is below. step is proportional to the estimate so it works at any scale.
+ */
+struct quantile_t {
+    float q;
+    float estimate;
+    float rate;
+};
+
+struct threshold_controller_t {
+    threshold_mode_t mode;
+    float threshold;            // current relative error threshold
+    float target;               // uplink fraction (BUDGET) or error bound (ERROR)
+    float gain;                 // maximum relative threshold change per sample
+    float min_threshold;
+    float max_threshold;
+    quantile_t error;           // reconstruction error quantile (ERROR)
+};
+
+void quantile_init(quantile_t * quantile, float q, float initial, float rate);
+
+void quantile_update(quantile_t * quantile, float x);
+
+/**
+ * controller - controller to set up
+ * mode - control policy
+ * initial - starting threshold, the only one used in THRESHOLD_FIXED
+ * target - fraction of samples to transmit (BUDGET) or bound on the error quantile (ERROR)
+ */
+void threshold_init(threshold_controller_t * controller, threshold_mode_t mode, float initial, float target);
+
+/**
+ * Feeds back one sample's outcome
+ * relative_error - |forecast - measured| / |measured|
+ * transmitted - the sample was sent, so its reconstruction error is only quantization
+ */
+void threshold_update(threshold_controller_t * controller, float relative_error, bool transmitted);
+
+#endif //THRESHOLD_H
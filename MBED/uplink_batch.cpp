@@ -0,0 +1,57 @@
+//
+// Aggregates corrected samples into as few LoRa frames as the data rate allows.
+//
+
+#include "uplink_batch.h"
+
+void batch_reset(uplink_batch_t * batch) {
+    batch->length = 0;
+    batch->count = 0;
+}
+
+int batch_add(uplink_batch_t * batch, const uplink_t * uplink, int max_size) {
+    int size = max_size < BATCH_MAX_SIZE ? max_size : BATCH_MAX_SIZE;
+    int written;
+
+    if (batch->count == 0) {
+        written = payload_encode(uplink, batch->buffer, size);
+        if (written < 0) {
+            return -1;
+        }
+        batch->first_sequence = uplink->sequence;
+    } else {
+        uplink_t record = *uplink;
+        record.skipped = uplink->sequence - batch->last.sequence - 1;
+        written = payload_encode_next(&batch->last, &record, batch->buffer + batch->length,
+                                      size - batch->length);
+        if (written < 0) {
+            return -1;
+        }
+    }
+
+    batch->length += written;
+    batch->count++;
+    batch->last = *uplink;
+    return 0;
+}
+
+bool batch_due(const uplink_batch_t * batch, uint32_t sequence, uint32_t max_latency, int max_size) {
+    if (batch->count == 0) {
+        return false;
+    }
+    // No room left for a worst case record
+    if (batch->length + PAYLOAD_RECORD_MAX_SIZE > max_size) {
+        return true;
+    }
+    return sequence - batch->first_sequence >= max_latency;
+}
+
+int eu868_max_payload(int data_rate) {
+    if (data_rate <= 2) {
+        return 51;
+    }
+    if (data_rate == 3) {
+        return 115;
+    }
+    return 222;
+}
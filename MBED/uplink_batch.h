@@ -0,0 +1,50 @@
+//
+// Aggregates corrected samples into as few LoRa frames as the data rate allows.
+//
+
+#ifndef UPLINK_BATCH_H
+#define UPLINK_BATCH_H
+
+#include <stdint.h>
+
+#include "payload.h"
+
+// Largest EU868 application payload (DR4 and above)
+#define BATCH_MAX_SIZE                  222
+
+struct uplink_batch_t {
+    uint8_t buffer[BATCH_MAX_SIZE];
+    int length;                 // bytes used in buffer
+    int count;                  // records in buffer
+    uplink_t last;              // last record appended, base of the next delta
+    uint32_t first_sequence;    // sequence of the oldest record, drives the latency deadline
+};
+
+/**
+ * Empties the batch, to be called once the frame has been handed to the stack
+ */
+void batch_reset(uplink_batch_t * batch);
+
+/**
+ * batch - current batch
+ * uplink - correction to append, its sequence must be after the last record
+ * max_size - maximum application payload at the current data rate
+ * Returns 0 when appended, -1 when the record does not fit and the batch must be flushed first
+ */
+int batch_add(uplink_batch_t * batch, const uplink_t * uplink, int max_size);
+
+/**
+ * Tells whether the batch should be sent now.
+ * batch - current batch
+ * sequence - current sample sequence, used as the batch clock
+ * max_latency - number of samples a correction may wait in the batch
+ * max_size - maximum application payload at the current data rate
+ */
+bool batch_due(const uplink_batch_t * batch, uint32_t sequence, uint32_t max_latency, int max_size);
+
+/**
+ * Maximum application payload (N) of the EU868 band for a data rate, see LoRaWAN Regional Parameters
+ */
+int eu868_max_payload(int data_rate);
+
+#endif //UPLINK_BATCH_H